@@ -15,6 +15,12 @@ AdaptorModel::AdaptorModel(QObject *obj)
 {
     model=static_cast <VymModel*> (obj);
     setAutoRelaySignals (true);
+
+    batchWatcher=new QDBusServiceWatcher (this);
+    batchWatcher->setConnection (QDBusConnection::sessionBus() );
+    batchWatcher->setWatchMode (QDBusServiceWatcher::WatchForUnregistration);
+    connect (batchWatcher, SIGNAL (serviceUnregistered (const QString &) ),
+	this, SLOT (batchClientGone (const QString &) ) );
 }
 
 void AdaptorModel::setModel(VymModel *vm)
@@ -51,6 +57,101 @@ QDBusVariant AdaptorModel::execute (const QString &s)
     return QDBusVariant (model->execute (s));
 }
 
+QString AdaptorModel::caller()
+{
+    return calledFromDBus() ? message().service() : QString();
+}
+
+bool AdaptorModel::batchAllowed()
+{
+    // Only one client may use a batch at a time
+    if (!model->isBatchActive() || batchClient==caller() ) return true;
+    model->parser.setError (Aborted, "Batch of other client is active");
+    return false;
+}
+
+void AdaptorModel::updateBatchClient()
+{
+    // Batch belongs to client, which began it, until it is finished
+    QString client= model->isBatchActive() ? caller() : QString();
+    if (client==batchClient) return;
+    batchClient=client;
+    if (batchClient.isEmpty() )
+	batchWatcher->setWatchedServices (QStringList() );
+    else
+	batchWatcher->setWatchedServices (QStringList (batchClient) );
+}
+
+void AdaptorModel::batchClientGone (const QString &service)
+{
+    if (service!=batchClient) return;
+    qWarning()<<"AdaptorModel: Client"<<service<<"vanished, aborting its batch";
+    model->abortBatch();
+    updateBatchClient();
+}
+
+QDBusVariant AdaptorModel::beginBatch()
+{
+    if (!batchAllowed() ) return QDBusVariant (model->parser.errorMessage() );
+    QVariant r=model->execute ("beginBatch ()");
+    updateBatchClient();
+    return QDBusVariant (r);
+}
+
+QDBusVariant AdaptorModel::commitBatch()
+{
+    if (!batchAllowed() ) return QDBusVariant (model->parser.errorMessage() );
+    QVariant r=model->execute ("commitBatch ()");
+    updateBatchClient();
+    return QDBusVariant (r);
+}
+
+QDBusVariant AdaptorModel::executeList (const QStringList &commands)
+{
+    // Either all commands succeed or the map is restored. 
+    // Results are returned as strings, invalid results can't be sent
+    if (!batchAllowed() ) return QDBusVariant (QStringList() );
+    bool outer=!model->isBatchActive();
+    QStringList results;
+    model->beginBatch();
+    foreach (QString s, commands)
+    {
+	QVariant r=model->execute (s);
+	if (model->parser.errorLevel()!=NoError)
+	{
+	    // Batch of caller around this list is left to caller
+	    QString e=model->parser.errorDescription();
+	    if (outer)
+		model->abortBatch();
+	    else
+		model->commitBatch();
+	    model->parser.setError (Aborted, e);
+	    return QDBusVariant (QStringList() );
+	}
+	results.append (r.toString() );
+    }
+    model->commitBatch();
+    return QDBusVariant (results);
+}
+
+QDBusVariant AdaptorModel::exportSubtree (const QString &id)
+{
+    TreeItem *ti= id.isEmpty() ? model->getSelectedItem() : model->findUuid (QUuid (id));
+    return QDBusVariant (model->getItemData (ti, true) );
+}
+
+QDBusVariant AdaptorModel::getItems (const QStringList &ids)
+{
+    QVariantList list;
+    foreach (QString id, ids)
+    {
+	QVariantMap map=model->getItemData (model->findUuid (QUuid (id)) );
+	map["id"]=id;	// also for unknown items, e.g. deleted meanwhile
+	list.append (map);
+    }
+    return QDBusVariant (list);
+}
+
 QDBusVariant AdaptorModel::errorLevel()
 {
     return QDBusVariant (model->parser.errorLevel() );
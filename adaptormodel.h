@@ -7,13 +7,21 @@
 class VymModel;
 class QString;
 
-class AdaptorModel: public QDBusAbstractAdaptor
+class AdaptorModel: public QDBusAbstractAdaptor, protected QDBusContext
 {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.insilmaril.vym.model.adaptor")
 
 private:
 	VymModel *model;
+	QString batchClient;		    // D-Bus service, which holds batch
+	QDBusServiceWatcher *batchWatcher;  // Abort batch, if client vanishes
+	QString caller();
+	bool batchAllowed();
+	void updateBatchClient();
+
+private slots:
+	void batchClientGone (const QString &service);
 
 public:
     AdaptorModel(QObject *obj);
@@ -28,12 +36,20 @@ public slots: // METHODS
     QDBusVariant getCurrentModelID();
     QDBusVariant branchCount();
     QDBusVariant execute (const QString &s);
+    QDBusVariant beginBatch();
+    QDBusVariant commitBatch();
+    QDBusVariant executeList (const QStringList &commands);
+    QDBusVariant exportSubtree (const QString &id);
+    QDBusVariant getItems (const QStringList &ids);
     QDBusVariant errorLevel();
     QDBusVariant errorDescription();
     QDBusVariant listCommands();
 
 Q_SIGNALS: // SIGNALS
     void crashed();
+    void itemsAdded   (const QStringList &ids);
+    void itemsChanged (const QStringList &ids);
+    void itemsRemoved (const QStringList &ids);
 };
 
 #endif
@@ -7,6 +7,7 @@
 #include "vymmodel.h"
 #include "xlink.h"
 #include "xlinkitem.h"
+#include "xmlobj.h"
 
 extern TaskModel *taskModel;
 
@@ -70,8 +71,10 @@ void BranchItem::insertBranch (int pos, BranchItem *branch)
     if (pos>branchCounter) pos=branchCounter;
     childItems.insert(pos+branchOffset,branch);
     branch->parentItem=this;
+    updateChildRows (pos+branchOffset, branch);
     branch->rootItem=rootItem;
     branch->setModel (model);
+    branch->setDepth (cachedDepth + 1);
     if (parentItem==rootItem)
 	setType (MapCenter);
     else
@@ -83,24 +86,13 @@ void BranchItem::insertBranch (int pos, BranchItem *branch)
     branchCounter++;
 }
 
-QString BranchItem::saveToDir (const QString &tmpdir,const QString &prefix, const QPointF& offset, QList <Link*> &tmpLinks ) 
+void BranchItem::saveToDir (XMLWriter &xw, const QString &tmpdir,const QString &prefix, const QPointF& offset, QList <Link*> &tmpLinks ) 
 {
     // Cloudy stuff can be hidden during exports
-    if (hidden) return QString();
-
-    // Save uuid 
-    QString idAttr=attribut("uuid",uuid.toString());
-
-    QString s,a;
+    if (hidden) return;
 
     // Update of note is usually done while unselecting a branch
     
-    QString scrolledAttr;
-    if (scrolled) 
-	scrolledAttr=attribut ("scrolled","yes");
-    else
-	scrolledAttr="";
-
     // save area, if not scrolled   // not needed if HTML is rewritten...
 				    // also we could check if _any_ of parents is scrolled
     QString areaAttr;
@@ -123,63 +115,68 @@ QString BranchItem::saveToDir (const QString &tmpdir,const QString &prefix, cons
     else
         elementName="branch";
 
-    // Free positioning of children
-    QString layoutAttr;
-    if (childrenLayout == BranchItem::FreePositioning)
-        layoutAttr += attribut ("childrenFreePos","true");
+    // Build begin element in a single buffer
+    QString s;
+    s.reserve (256);
+    appendIndent (s);
+    s.append ('<');
+    s.append (elementName);
+    s.append (getMapAttr() );
+    s.append (getGeneralAttr() );
+    if (scrolled) 
+	appendAttribut (s, "scrolled", "yes");
+    s.append (getIncludeImageAttr() );
 
     // Save rotation
-    QString rotAttr;
     if (mo && mo->getRotation() !=0 )
-	rotAttr=attribut ("rotation",QString().setNum (mo->getRotation() ) );
-
-    s=beginElement (elementName
-	+ getMapAttr()
-	+ getGeneralAttr()
-	+ scrolledAttr 
-	+ getIncludeImageAttr() 
-    + rotAttr
-    + layoutAttr
-	+ idAttr
-	);
+	appendAttribut (s, "rotation", QString().setNum (mo->getRotation() ) );
+
+    // Free positioning of children
+    if (childrenLayout == BranchItem::FreePositioning)
+        appendAttribut (s, "childrenFreePos", "true");
+
+    // Save uuid 
+    appendAttribut (s, "uuid", uuid.toString() );
+    s.append ('>');
+    xw << s;
     incIndent();
 
     // save heading
-    s += heading.saveToDir();
+    xw << heading.saveToDir();
 
     // Save frame  // not saved if there is no MO
     if (mo)
     {
         // Avoid saving NoFrame for objects other than MapCenter
         if (depth() == 0  || ((OrnamentedObj*)mo)->getFrame()->getFrameType()!=FrameObj::NoFrame)
-            s+=((OrnamentedObj*)mo)->getFrame()->saveToDir ();
+            xw << ((OrnamentedObj*)mo)->getFrame()->saveToDir ();
     }
 
     // save names of flags set
-    s+=standardFlags.saveToDir(tmpdir,prefix,0);
+    xw << standardFlags.saveToDir(tmpdir,prefix,0);
     
     // Save Images
     for (int i=0; i<imageCount(); ++i)
-	s+=getImageNum(i)->saveToDir (tmpdir,prefix);
+	xw << getImageNum(i)->saveToDir (tmpdir,prefix);
 
     // save attributes
     for (int i=0; i<attributeCount(); ++i)
-	s+=getAttributeNum(i)->getDataXML();
+	xw << getAttributeNum(i)->getDataXML();
 
     // save note
     if (!note.isEmpty() )
-	s+=note.saveToDir();
+	xw << note.saveToDir();
     
     // save task
     if (task)
-	s+=task->saveToDir();
+	xw << task->saveToDir();
 
     // Save branches
     int i=0;
     TreeItem *ti=getBranchNum(i);
     while (ti)
     {
-	s+=getBranchNum(i)->saveToDir(tmpdir,prefix,offset,tmpLinks);
+	getBranchNum(i)->saveToDir(xw,tmpdir,prefix,offset,tmpLinks);
 	i++;
 	ti=getBranchNum(i);
     }	
@@ -191,8 +188,7 @@ QString BranchItem::saveToDir (const QString &tmpdir,const QString &prefix, cons
 	if (l && !tmpLinks.contains (l)) tmpLinks.append (l);
     }
     decIndent();
-    s += endElement (elementName);
-    return s;
+    xw << endElement (elementName);
 }
 
 void BranchItem::updateVisibility()
@@ -251,6 +247,8 @@ bool BranchItem::toggleScroll()
     {
 	scrolled=false;
 	systemFlags.deactivate("system-scrolledright");
+	// Subtree has been cleaned without alignment while scrolled
+	if (mo) ((BranchObj*)mo)->setAllRepositionRequests();
 	if (branchCounter>0)
 	    for (int i=0;i<branchCounter;++i)
 	    {
@@ -268,6 +266,7 @@ bool BranchItem::toggleScroll()
 		if (bo) bo->setVisibility(false);
 	    }
     }
+    if (mo) ((BranchObj*)mo)->requestReposition();
     return true;
 }
 
@@ -367,6 +366,14 @@ void BranchItem::sortChildren(bool inverse) //FIXME-4 optimize by not using move
 void BranchItem::setChildrenLayout(BranchItem::LayoutHint layoutHint)
 {
     childrenLayout = layoutHint;
+
+    // Children switch between relative and aligned positions
+    BranchObj *bo;
+    for (int i=0;i<branchCounter;++i)
+    {
+	bo=(BranchObj*)(getBranchNum(i)->getMO());
+	if (bo) bo->requestReposition();
+    }
 }
 
 BranchItem::LayoutHint BranchItem::getChildrenLayout()
@@ -11,6 +11,7 @@ class QGraphicsScene;
 class BranchObj;
 class Link;
 class XLinkItem;
+class XMLWriter;
 
 class BranchItem:public MapItem
 {
@@ -25,7 +26,7 @@ public:
 
     virtual void insertBranch (int pos,BranchItem *branch);
 
-    virtual QString saveToDir (const QString &tmpdir,const QString &prefix, const QPointF& offset,QList <Link*> &tmpLinks);
+    virtual void saveToDir (XMLWriter &xw, const QString &tmpdir,const QString &prefix, const QPointF& offset,QList <Link*> &tmpLinks);
 
     virtual void updateVisibility();
 
@@ -0,0 +1,149 @@
+#include "branchiterator.h"
+
+#include "branchitem.h"
+
+BranchIterator::BranchIterator (BranchItem *start, Order order, int flags)
+{
+    this->start=start;
+    this->order=order;
+    this->flags=flags;
+    current=NULL;
+    if (!start) return;
+
+    // The rootItem is not a branch by itself, only its children are walked
+    startIsRoot= start->depth()<0;
+
+    BranchItem *first=start;
+    if (startIsRoot)
+	first=firstChild (start);
+    else if (skip (start))
+	first=NULL;
+    if (!first) return;
+
+    switch (order)
+    {
+	case PreOrder: 
+	    current=first;
+	    break;
+	case PostOrder:
+	    current=firstLeaf (first);
+	    break;
+	case BreadthFirst:
+	    // All mapcenters are on the first level
+	    current=first;
+	    if (startIsRoot)
+	    {
+		first=nextSibling (first);
+		while (first)
+		{
+		    queue.enqueue (first);
+		    first=nextSibling (first);
+		}
+	    }
+	    break;
+    }
+}
+
+bool BranchIterator::hasNext() const
+{
+    return current!=NULL;
+}
+
+BranchItem* BranchIterator::next()
+{
+    BranchItem *cur=current;
+    if (!cur) return NULL;
+    current=NULL;
+
+    switch (order)
+    {
+	case PreOrder:
+	{
+	    BranchItem *bi=firstChild (cur);
+	    if (bi)
+	    {
+		current=bi;
+		break;
+	    }
+	    // No children, go up until there is a sibling
+	    bi=cur;
+	    while (bi && bi!=start)
+	    {
+		BranchItem *sibling=nextSibling (bi);
+		if (sibling)
+		{
+		    current=sibling;
+		    break;
+		}
+		bi=bi->parentBranch();
+	    }
+	    break;
+	}
+	case PostOrder:
+	{
+	    if (cur==start) break;
+	    BranchItem *sibling=nextSibling (cur);
+	    if (sibling)
+		current=firstLeaf (sibling);
+	    else
+	    {
+		BranchItem *pb=cur->parentBranch();
+		if (!(startIsRoot && pb==start)) current=pb;
+	    }
+	    break;
+	}
+	case BreadthFirst:
+	{
+	    BranchItem *bi=firstChild (cur);
+	    while (bi)
+	    {
+		queue.enqueue (bi);
+		bi=nextSibling (bi);
+	    }
+	    if (!queue.isEmpty() ) current=queue.dequeue();
+	    break;
+	}
+    }
+    return cur;
+}
+
+bool BranchIterator::skip (BranchItem *bi) const
+{
+    return (flags & SkipHidden) && (bi->isHidden() || bi->hideInExport() );
+}
+
+BranchItem* BranchIterator::firstChild (BranchItem *bi) const
+{
+    if ((flags & SkipScrolled) && bi->isScrolled() ) return NULL;
+    int n=bi->branchCount();
+    for (int i=0; i<n; i++)
+    {
+	BranchItem *child=bi->getBranchNum (i);
+	if (!skip (child)) return child;
+    }
+    return NULL;
+}
+
+BranchItem* BranchIterator::nextSibling (BranchItem *bi) const
+{
+    BranchItem *pb=bi->parentBranch();
+    if (!pb) return NULL;
+    int n=pb->branchCount();
+    for (int i=bi->num()+1; i<n; i++)
+    {
+	BranchItem *sibling=pb->getBranchNum (i);
+	if (!skip (sibling)) return sibling;
+    }
+    return NULL;
+}
+
+BranchItem* BranchIterator::firstLeaf (BranchItem *bi) const
+{
+    BranchItem *child=firstChild (bi);
+    while (child)
+    {
+	bi=child;
+	child=firstChild (bi);
+    }
+    return bi;
+}
@@ -0,0 +1,74 @@
+#ifndef BRANCHITERATOR_H
+#define BRANCHITERATOR_H
+
+#include <QQueue>
+
+class BranchItem;
+
+/////////////////////////////////////////////////////////////////////////////
+/*! \brief Walk through the branches of a map or of a subtree
+
+    The start branch itself is part of the walk. If start is the rootItem
+    of the model, all mapcenters and their children are visited.
+
+    Pre- and post-order walks follow parent and sibling links, breadth first
+    walks use a queue. The tree must not be changed structurally during the
+    walk, changing e.g. headings, colors or scroll state is fine.
+
+    Usage:
+
+	BranchIterator it (model->getRootItem() );
+	while (it.hasNext() )
+	{
+	    BranchItem *bi=it.next();
+	    ...
+	}
+
+    or with range-based for:
+
+	for (BranchItem *bi : BranchIterator (selbi, BranchIterator::PostOrder) )
+*/
+class BranchIterator
+{
+public:
+    enum Order {PreOrder, PostOrder, BreadthFirst};
+    enum Flag {
+	NoFlags	    = 0x0,
+	SkipScrolled= 0x1,  //!< Don't visit children of scrolled branches
+	SkipHidden  = 0x2   //!< Don't visit branches hidden in export and their children
+    };
+
+    BranchIterator (BranchItem *start, Order order=PreOrder, int flags=NoFlags);
+
+    bool hasNext() const;
+    BranchItem* next();
+
+    class iterator
+    {
+    public:
+	iterator (BranchIterator *bi) : walk(bi) {}
+	BranchItem* operator* () const { return walk->current; }
+	iterator& operator++ () { walk->next(); return *this; }
+	bool operator!= (const iterator &other) const 
+	    { return (walk ? walk->current : 0) != (other.walk ? other.walk->current : 0); }
+    private:
+	BranchIterator *walk;
+    };
+    iterator begin() { return iterator (this); }
+    iterator end()   { return iterator (0); }
+
+private:
+    bool skip (BranchItem *bi) const;
+    BranchItem* firstChild (BranchItem *bi) const;
+    BranchItem* nextSibling (BranchItem *bi) const;
+    BranchItem* firstLeaf (BranchItem *bi) const;
+
+    BranchItem *start;
+    BranchItem *current;    //!< Returned by next call of next()
+    bool startIsRoot;
+    Order order;
+    int flags;
+    QQueue <BranchItem*> queue;
+};
+
+#endif
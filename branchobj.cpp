@@ -47,6 +47,8 @@ BranchObj::~BranchObj ()
 void BranchObj::init () 
 {
     if (parObj) absPos=parObj->getChildRefPos();
+    alignRefSelf=false;
+    requestReposition();
 }
 
 void BranchObj::copy (BranchObj* other)
@@ -150,6 +152,7 @@ void BranchObj::unsetParObjTmp()
         parObjTmpBuf=NULL;
         setLinkStyle (getDefLinkStyle(treeItem->parent() ) );
         updateLinkGeometry();
+        requestReposition();
     }
 }
 
@@ -211,6 +214,7 @@ void BranchObj::positionContents()
 void BranchObj::move (double x, double y)
 {
     OrnamentedObj::move (x,y);
+    requestReposition();
 }
 
 void BranchObj::move (QPointF p)
@@ -220,10 +224,12 @@ void BranchObj::move (QPointF p)
 
 void BranchObj::moveBy (double x, double y)
 {
-    OrnamentedObj::moveBy (x,y);
+    // Move the whole subtree top-down: Children see the new childRefPos
+    // of their parent, so their links are only translated
+    OrnamentedObj::move (absPos.x() + x, absPos.y() + y);
+    alignRef+=QPointF (x,y);
     for (int i=0; i<treeItem->branchCount(); ++i)
 	treeItem->getBranchObjNum(i)->moveBy (x,y);
-    positionBBox();
 }
     
 void BranchObj::moveBy (QPointF p)
@@ -324,6 +330,9 @@ void BranchObj::calcBBoxSize()
     // Finally set size
     bbox.setSize (QSizeF (w,h));
     //if (debug) qDebug()<<"BO: calcBBox "<<treeItem->getHeading()<<" bbox="<<bbox;
+
+    // bboxTotal of parents has to be updated, too
+    requestReposition();
 }
 
 void BranchObj::setDockPos()
@@ -463,6 +472,18 @@ void BranchObj::setDefAttr (BranchModification mod, bool keepFrame)
 
 void BranchObj::alignRelativeTo (QPointF ref,bool alignSelf)
 {
+    // Neither I nor my children changed and I stay where I am,
+    // so the whole subtree can be skipped. Links without geometry,
+    // e.g. after changing the link style, need a full alignment
+    if (!repositionRequest && !anim.isAnimated() && 
+        (linkGeometryValid || style==UndefinedStyle) &&
+        alignSelf==alignRefSelf && ref==alignRef) 
+    {
+        // Only my parent might have changed, so update link to it
+        updateLinkGeometry();
+        return;
+    }
+
     // Define some heights
     qreal th = bboxTotal.height();  
     qreal ch=0; // Sum of childrens heights
@@ -497,6 +518,21 @@ void BranchObj::alignRelativeTo (QPointF ref,bool alignSelf)
             useRelPos = false;
     }
 
+    // Neither I nor my children changed, but my parent moved: 
+    // Move subtree in one go instead of aligning it again
+    if (depth > 1 && !useRelPos && !repositionRequest && !anim.isAnimated() &&
+        (linkGeometryValid || style==UndefinedStyle) && alignSelf && alignRefSelf)
+    {
+        Orientation o = orientation;
+        setOrientation();
+        if (o == orientation)
+        {
+            moveBy (ref - alignRef);
+            setAlignClean (ref, alignSelf);
+            return;
+        }
+    }
+
 // TODO testing
 /*
     if (debug)
@@ -573,8 +609,14 @@ void BranchObj::alignRelativeTo (QPointF ref,bool alignSelf)
         }
     }
 
-    // Without ancestors I am done
-    if ( ((BranchItem*)treeItem)->isScrolled() ) return;
+    // Without ancestors I am done. Children are marked again, 
+    // when I am unscrolled
+    if ( ((BranchItem*)treeItem)->isScrolled() ) 
+    {
+        unsetAllRepositionRequests();
+        setAlignClean (ref, alignSelf);
+        return;
+    }
 
     // Set reference point for alignment of children
     QPointF ref2;
@@ -603,8 +645,20 @@ void BranchObj::alignRelativeTo (QPointF ref,bool alignSelf)
 
             // append next branch below current one
             ref2.setY(ref2.y() + treeItem->getBranchObjNum(i)->getTotalBBox().height() );
-        }
+        } else
+            // Marked again, when unhidden
+            treeItem->getBranchObjNum(i)->unsetAllRepositionRequests();
     }
+    setAlignClean (ref, alignSelf);
+}
+
+void BranchObj::setAlignClean (const QPointF &ref, bool alignSelf)
+{
+    // Moving myself and my children marked me dirty again, 
+    // so only now I am clean
+    repositionRequest=false;
+    alignRef=ref;
+    alignRefSelf=alignSelf;
 }
 
 void BranchObj::reposition()
@@ -619,11 +673,9 @@ void BranchObj::reposition()
     }
 */	
 
-    if (treeItem->depth()==0)
-	// only calculate the sizes once. If the deepest LMO 
-	// changes its height,
-	// all upper LMOs have to change, too.
-	calcBBoxSizeWithChildren(); 
+    // Sizes are only recalculated for dirty subtrees. If the deepest LMO 
+    // changes its height, all upper LMOs have been marked, too.
+    calcBBoxSizeWithChildren(); 
 
     alignRelativeTo ( QPointF (absPos.x(),
         absPos.y()-(bboxTotal.height()-bbox.height())/2) );	
@@ -636,6 +688,13 @@ void BranchObj::unsetAllRepositionRequests()
         treeItem->getBranchObjNum(i)->unsetAllRepositionRequests();
 }
 
+void BranchObj::setAllRepositionRequests()
+{
+    repositionRequest=true;
+    for (int i=0; i<treeItem->branchCount(); ++i)
+        treeItem->getBranchObjNum(i)->setAllRepositionRequests();
+}
+
 QRectF BranchObj::getTotalBBox()
 {
     return bboxTotal;
@@ -661,6 +720,9 @@ ConvexPolygon BranchObj::getBoundingPolygon()
 
 void BranchObj::calcBBoxSizeWithChildren()  
 {   
+    // bboxTotal of clean subtrees is still valid
+    if (!repositionRequest) return;
+
     // if branch is scrolled, ignore children, but still consider floatimages
     BranchItem *bi=(BranchItem*)treeItem;
     if ( bi->isScrolled() )
@@ -721,17 +783,17 @@ void BranchObj::stopAnimation()
         move (anim);
 }
 
-bool BranchObj::animate()
+bool BranchObj::animate(uint ticks)
 {
-    anim.animate ();
-    if ( anim.isAnimated() )
-    {
-        if (useRelPos)
-            setRelPos (anim);
-        else
-            move (anim);
-        return true;
-    }
-    return false;
+    if ( !anim.isAnimated() ) return false;
+
+    // Advance several ticks, but move only once
+    for (uint i=0; i<ticks && anim.isAnimated(); i++)
+        anim.animate ();
+    if (useRelPos)
+        setRelPos (anim);
+    else
+        move (anim);
+    return anim.isAnimated();
 }
 
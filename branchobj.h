@@ -45,6 +45,7 @@ public:
     virtual void alignRelativeTo(const QPointF, bool alignSelf=false );
     virtual void reposition();
     virtual void unsetAllRepositionRequests();
+    virtual void setAllRepositionRequests();	//!< Mark whole subtree dirty
 
     virtual QRectF getTotalBBox();	// return size of BBox including children  
     virtual ConvexPolygon getBoundingPolygon();
@@ -52,10 +53,15 @@ public:
 
     virtual void setAnimation(const AnimPoint &ap);
     virtual void stopAnimation();
-    virtual bool animate();
+    virtual bool animate(uint ticks=1);	// Returns false when done
 
 protected:
     AnimPoint anim;
+
+private:
+    void setAlignClean (const QPointF &ref, bool alignSelf);
+    QPointF alignRef;		    // ref and alignSelf of last alignment, 
+    bool alignRefSelf;		    // clean subtrees with same ref are skipped
 };
 
 
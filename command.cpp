@@ -1,10 +1,11 @@
 #include "command.h"
 
 #include <QDebug>
-Command::Command (const QString &n, SelectionType st)
+Command::Command (const QString &n, SelectionType st, int id)
 {
     name=n;
     selectionType=st;
+    commandID=id;
 }
 
 QString Command::getName()
@@ -12,6 +13,11 @@ QString Command::getName()
     return name;
 }
 
+int Command::getID()
+{
+    return commandID;
+}
+
 QString Command::getDescription()
 {
     QString s;
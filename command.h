@@ -9,8 +9,9 @@ class Command
 public:
     enum SelectionType {Any, TreeItem, Branch, BranchLike, Image, BranchOrImage, XLink}; 
     enum ParameterType {Undefined,String, Int, Double, Color, Bool};
-    Command (const QString &n, SelectionType st);
+    Command (const QString &n, SelectionType st, int id=0);
     QString getName();
+    int getID();			    //!< Used to dispatch command
     QString getDescription();
     QString getDescriptionLaTeX();
     void addPar (ParameterType t, bool opt, const QString &c=QString() );
@@ -24,6 +25,7 @@ public:
 
 private:
 	QString name;
+	int commandID;
 	SelectionType selectionType;
 	QList <ParameterType> parTypes;
 	QList <bool> parOpts;
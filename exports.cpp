@@ -7,6 +7,7 @@
 #include <QMessageBox>
 
 #include "branchitem.h"
+#include "branchiterator.h"
 #include "file.h"
 #include "linkablemapobj.h"
 #include "misc.h"
@@ -251,12 +252,11 @@ void ExportAO::doExport()
     QString dashIndent;
 
     int i;
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
 
-    model->nextBranch (cur,prev);
-    while (cur)
+    BranchIterator it (model->getRootItem() );
+    while (it.hasNext() )
     {
+        BranchItem *cur=it.next();
         QString line;
         QString colString="";
         QString noColString;
@@ -353,7 +353,6 @@ void ExportAO::doExport()
                 }
             }
         }
-        model->nextBranch(cur,prev);
     }
     file.close();
     completeExport();
@@ -392,16 +391,15 @@ void ExportASCII::doExport()
     QString curIndent;
     QString dashIndent;
     int i;
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
 
     int lastDepth=0;
 
     QStringList tasks;
 
-    model->nextBranch (cur,prev);
-    while (cur)
+    BranchIterator it (model->getRootItem() );
+    while (it.hasNext() )
     {
+        BranchItem *cur=it.next();
         if (cur->getType()==TreeItem::Branch || cur->getType()==TreeItem::MapCenter)
         {
             // Insert newline after previous list
@@ -470,7 +468,6 @@ void ExportASCII::doExport()
                 lastDepth = cur->depth();
             }
         }
-        model->nextBranch(cur,prev);
     }
 
     if (listTasks)
@@ -524,11 +521,10 @@ void ExportCSV::doExport()
     QString s;
     QString curIndent("");
     int i;
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
-    model->nextBranch (cur,prev);
-    while (cur)
+    BranchIterator it (model->getRootItem() );
+    while (it.hasNext() )
     {
+        BranchItem *cur=it.next();
         if (!cur->hasHiddenExportParent() )
         {
             // If necessary, write note
@@ -547,7 +543,6 @@ void ExportCSV::doExport()
             ts << curIndent << "\"" << cur->getHeadingPlain()<<"\""<<endl;
         }
 
-        model->nextBranch(cur,prev);
         curIndent="";
     }
     file.close();
@@ -856,22 +851,18 @@ QString ExportHTML::createTOC()
     toc += "\n";
     toc += "</td></tr>\n";
     toc += "<tr><td>\n";
-    BranchItem *cur  = NULL;
-    BranchItem *prev = NULL;
-    model->nextBranch(cur, prev);
-    while (cur)
+    BranchIterator it (model->getRootItem(), BranchIterator::PreOrder, 
+        BranchIterator::SkipHidden | BranchIterator::SkipScrolled);
+    while (it.hasNext() )
     {
-        if (!cur->hasHiddenExportParent() && !cur->hasScrolledParent() )
-        {
-            if (dia.useNumbering) number = getSectionString(cur);
-            toc += QString("<div class=\"vym-toc-branch-%1\">").arg(cur->depth());
-            toc += QString("<a href=\"#%1\"> %2 %3</a></br>\n")
-                    .arg(model->getSelectString(cur))
-                    .arg(number)
-                    .arg(quotemeta( cur->getHeadingPlain() ));
-            toc += "</div>";
-        }
-        model->nextBranch(cur,prev);
+        BranchItem *cur=it.next();
+        if (dia.useNumbering) number = getSectionString(cur);
+        toc += QString("<div class=\"vym-toc-branch-%1\">").arg(cur->depth());
+        toc += QString("<a href=\"#%1\"> %2 %3</a></br>\n")
+                .arg(model->getSelectString(cur))
+                .arg(number)
+                .arg(quotemeta( cur->getHeadingPlain() ));
+        toc += "</div>";
     }
     toc += "</td></tr>\n";
     toc += "</table>\n";
@@ -1076,11 +1067,10 @@ void ExportOrgMode::doExport()
     // Main loop over all branches
     QString s;
     int i;
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
-    model->nextBranch(cur,prev);
-    while (cur)
+    BranchIterator it (model->getRootItem() );
+    while (it.hasNext() )
     {
+        BranchItem *cur=it.next();
         if (!cur->hasHiddenExportParent() )
         {
             for(i=0;i<=cur->depth();i++)
@@ -1093,7 +1083,6 @@ void ExportOrgMode::doExport()
                 ts << ("\n");
             }
         }
-        model->nextBranch(cur,prev);
     }
     file.close();
 
@@ -1169,11 +1158,10 @@ void ExportLaTeX::doExport()
 
     // Main loop over all branches
     QString s;
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
-    model->nextBranch(cur,prev);
-    while (cur)
+    BranchIterator it (model->getRootItem() );
+    while (it.hasNext() )
     {
+        BranchItem *cur=it.next();
         if (!cur->hasHiddenExportParent() )
         {
             int d=cur->depth();
@@ -1195,7 +1183,6 @@ void ExportLaTeX::doExport()
                 ts << endl;
             }
         }
-        model->nextBranch(cur,prev);
     }
     
     file.close();
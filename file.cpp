@@ -10,7 +10,7 @@
 
 
 #include "file.h"
-#include "vymprocess.h"
+#include "zipfile.h"
 
 #if defined(Q_OS_WIN32)
     #include "mkdtemp.h"
@@ -23,8 +23,6 @@
 
 using namespace File;
 
-extern QString zipToolPath;
-
 QString convertToRel (const QString &src, const QString &dst)
 {
     // Creates a relative path pointing from src to dst
@@ -245,7 +243,6 @@ ErrorCode zipDir ( QDir zipInputDir, QString zipName)
 {
     zipName = QDir::toNativeSeparators(zipName);
     ErrorCode err = Success;
-    bool result;
     QString symLinkTarget;
 
     QString newName;
@@ -270,89 +267,15 @@ ErrorCode zipDir ( QDir zipInputDir, QString zipName)
     }
 
     // zip the temporary directory
-    VymProcess *zipProc=new VymProcess ();
-    QStringList args;
-
-#if defined(Q_OS_WIN32)
-    zipProc->setWorkingDirectory (QDir::toNativeSeparators(zipInputDir.path() + "\\") );    
-    args << "a" << zipName << "-tzip" << "-scsUTF-8"  << "*";
-    zipProc->start(zipToolPath, args);
- 
-    if (!zipProc->waitForStarted())
+    ZipWriter zip (zipName);
+    if (!zip.open() || !zip.addDir (zipInputDir) || !zip.close() )
     {
         QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
-            QObject::tr("Couldn't start tool to decompress data."));
+                               QObject::tr("Couldn't compress data.") + 
+                               "\n" + zip.errorString() );
         err=Aborted;
-
     }
-    /*while(zipProc->state()!=QProcess::NotRunning){
-        zipProc->waitForReadyRead();
-        result = zipProc->readAll();
-    }*/
-    
-    if (!zipProc->waitForStarted() )
-    {
-        // zip could not be started
-        QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
-                               QObject::tr("Couldn't start zip to compress data."));
-        err=Aborted;
-    } else
-    {
-        // zip could be started
-        zipProc->waitForFinished();
-        if (zipProc->exitStatus()!=QProcess::NormalExit )
-        {
-            QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
-                                   QObject::tr("zip didn't exit normally")+
-                                   "\n" + zipProc->getErrout());
-            err=Aborted;
-        } else
-        {
-            if (zipProc->exitCode()>0)
-            {
-                QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
-                                       QString("zip exit code:  %1").arg(zipProc->exitCode() )+
-                                       "\n" + zipProc->getErrout() );
-                err=Aborted;
-            }
-        }
-    }
-    // qDebug() <<"Output: " << zipProc->getStdout()<<flush;   
-#else
-    zipProc->setWorkingDirectory (QDir::toNativeSeparators(zipInputDir.path() ));  
-    args <<"-r";
-    args <<zipName;
-    args <<".";
 
-    zipProc->start ("zip",args);
-    if (!zipProc->waitForStarted() )
-    {
-        // zip could not be started
-        QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
-                               QObject::tr("Couldn't start zip to compress data."));
-        err=Aborted;
-    } else
-    {
-        // zip could be started
-        zipProc->waitForFinished();
-        if (zipProc->exitStatus()!=QProcess::NormalExit )
-        {
-            QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
-                                   QObject::tr("zip didn't exit normally")+
-                                   "\n" + zipProc->getErrout());
-            err=Aborted;
-        } else
-        {
-            if (zipProc->exitCode()>0)
-            {
-                QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
-                                       QString("zip exit code:  %1").arg(zipProc->exitCode() )+
-                                       "\n" + zipProc->getErrout() );
-                err=Aborted;
-            }
-        }
-    }
-#endif
     // Try to restore previous file, if zipping failed
     if (err == Aborted && !newName.isEmpty() && !file.rename (zipName) )
 	QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
@@ -397,72 +320,19 @@ ErrorCode zipDir ( QDir zipInputDir, QString zipName)
 
 File::ErrorCode unzipDir ( QDir zipOutputDir, QString zipName)
 {
-    ErrorCode err=Success;
-
-    VymProcess *zipProc = new VymProcess ();
-    QStringList args;
+    ZipReader zip (zipName);
+    if (!zip.open() )
+        // no zipped file, but maybe .xml or old version? Try again.
+        return NoZip;
 
-#if defined(Q_OS_WIN32)
-    zipProc->setWorkingDirectory (QDir::toNativeSeparators(zipOutputDir.path() + "\\") );
-    args << "-o" + zipOutputDir.path() << "x" << zipName.toUtf8() << "-scsUTF-8";
-    zipProc->start(zipToolPath, args);
-
-    if (!zipProc->waitForStarted())
+    if (!zip.extractAll (zipOutputDir) )
     {
         QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
-                               QObject::tr("Couldn't start tool to decompress data."));
-        err=Aborted;
-    }
-
-    /*while(zipProc->state()!=QProcess::NotRunning){
-        zipProc->waitForReadyRead();
-        result = zipProc->readAll();
-        //qDebug() << result << flush;
-    }*/
-    //qDebug() << zipProc->getStdout()<<flush;
-#else
-    zipProc->setWorkingDirectory (QDir::toNativeSeparators(zipOutputDir.path()));
-    args << "-o";   // overwrite existing files!
-    args << zipName ;
-    args << "-d";
-    args << zipOutputDir.path();
-
-    zipProc->start ("unzip",args);
-#endif
-    if (!zipProc->waitForStarted() )
-    {
-        QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
-                               QObject::tr("Couldn't start %1 to decompress data.").arg(zipToolPath));
-        err=Aborted;
-
-
-    } else
-    {
-        zipProc->waitForFinished();
-        if (zipProc->exitStatus()!=QProcess::NormalExit )
-        {
-            QMessageBox::critical( 0,QObject::tr( "Critical Error" ),
-                                   QObject::tr("%1 didn't exit normally").arg(zipToolPath) +
-                                   zipProc->getErrout() );
-            err=Aborted;
-        } else
-        {
-            if (zipProc->exitCode()>0)
-            {
-                if (zipProc->exitCode()==9)
-                    // no zipped file, but maybe .xml or old version? Try again.
-                    err=NoZip;
-                else
-                {
-                    QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
-                                           QString("%1 exit code:  %2").arg(zipToolPath).arg(zipProc->exitCode() ) +
-                                           zipProc->getErrout() );
-                    err=Aborted;
-                }
-            }
-        }
+                               QObject::tr("Couldn't decompress data.") +
+                               "\n" + zip.errorString() );
+        return Aborted;
     }
-    return err;
+    return Success;
 }
 
 bool loadStringFromDisk (const QString &fname, QString &s)
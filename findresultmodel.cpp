@@ -13,6 +13,7 @@ FindResultModel::FindResultModel( QObject *parent)
     QVector<QVariant> rootData;
     rootData << "Heading";
     rootItem = new FindResultItem(rootData);
+    owner = NULL;
     showParentsLevel = settings.value("/satellite/findResults/showParentsLevel", 1).toInt();
 }
 
@@ -256,6 +257,16 @@ QString FindResultModel::getSearchString()
     return searchString;
 }
 
+void FindResultModel::setOwner (VymModel *m)
+{
+    owner = m;
+}
+
+VymModel* FindResultModel::getOwner()
+{
+    return owner;
+}
+
 void FindResultModel::setSearchFlags( QTextDocument::FindFlags f)
 {
     searchFlags=f;
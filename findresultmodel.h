@@ -8,6 +8,7 @@
 
 class FindResultItem;
 class TreeItem;
+class VymModel;
 
 class FindResultModel : public QAbstractItemModel
 {
@@ -56,9 +57,12 @@ public:
     QTextDocument::FindFlags getSearchFlags();
     void setShowParentsLevel(uint i);
     uint getShowParentsLevel();
+    void setOwner (VymModel *m);    //!< Map currently searching into this model
+    VymModel* getOwner();
 
 private:
     uint showParentsLevel;
+    VymModel *owner;
 
     FindResultItem *rootItem;
 
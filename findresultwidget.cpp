@@ -22,6 +22,11 @@ FindResultWidget::FindResultWidget(QWidget *)
 	findWidget, SIGNAL (nextButton (QString) ), 
 	this, SLOT (nextButtonPressed (QString) ) );
 
+    // Search while typing, this also cancels the search for the previous text
+    connect (
+	findWidget, SIGNAL (findTextEdited (QString) ), 
+	this, SLOT (nextButtonPressed (QString) ) );
+
 
     QVBoxLayout* mainLayout = new QVBoxLayout;
     
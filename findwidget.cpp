@@ -74,9 +74,10 @@ void FindWidget::nextPressed()
     emit (nextButton(findcombo->currentText() ) );
 }
 
-void FindWidget::findTextChanged(const QString&)
+void FindWidget::findTextChanged(const QString &s)
 {
     setStatus (Undefined);
+    emit (findTextEdited (s) );
 }
 
 void FindWidget::setFocus()
@@ -31,6 +31,7 @@ private:
 signals:
     void hideFindWidget();
     void nextButton(QString);
+    void findTextEdited(QString);
 
 private:
     QComboBox *findcombo;
@@ -0,0 +1,85 @@
+#include "findworker.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+FindWorker::FindWorker (const QString &s, Qt::CaseSensitivity cs, const QList <Entry> &list, QObject *parent) : QThread (parent)
+{
+    searchString=s;
+    caseSensitivity=cs;
+    entries=list;
+}
+
+void FindWorker::cancel()
+{
+    canceled.store (1);
+}
+
+bool FindWorker::isCanceled()
+{
+    return canceled.load()!=0;
+}
+
+QList <FindWorker::Result> FindWorker::takeResults()
+{
+    QMutexLocker locker (&mutex);
+    QList <Result> list=results;
+    results.clear();
+    return list;
+}
+
+void FindWorker::run()
+{
+    // Hand over first hit immediately, then in batches
+    const int batchSize=100;
+    const int batchTime=100;	// ms
+    QElapsedTimer timer;
+    timer.start();
+    bool first=true;
+
+    QList <Result> batch;
+    for (int e=0; e<entries.count(); e++)
+    {
+	if (isCanceled() ) return;
+
+	const Entry &entry=entries.at(e);
+	bool hit=entry.heading.getTextASCII().contains (searchString, caseSensitivity) ||
+	    entry.url.contains (searchString, caseSensitivity);
+	for (int a=0; !hit && a<entry.attributes.count(); a++)
+	    hit=entry.attributes.at(a).getTextASCII().contains (searchString, caseSensitivity);
+
+	Result r;
+	r.id=entry.id;
+	QString note=entry.note.getTextASCII();
+	int i=note.indexOf (searchString, 0, caseSensitivity);
+	if (i>=0)
+	{
+	    QString n=note;
+	    n.replace ('\n', ' ');
+	    while (i>=0)
+	    {
+		r.noteHits.append (n.mid (i-8, 80) );
+		i=note.indexOf (searchString, i+1, caseSensitivity);
+	    }
+	}
+	if (hit || !r.noteHits.isEmpty() ) batch.append (r);
+
+	if (!batch.isEmpty() && (first || batch.count()>=batchSize || timer.elapsed()>batchTime) )
+	{
+	    mutex.lock();
+	    results+=batch;
+	    mutex.unlock();
+	    batch.clear();
+	    first=false;
+	    timer.restart();
+	    emit (resultsReady() );
+	}
+    }
+    if (!batch.isEmpty() )
+    {
+	mutex.lock();
+	results+=batch;
+	mutex.unlock();
+	emit (resultsReady() );
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef FINDWORKER_H
+#define FINDWORKER_H
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+
+#include "vymtext.h"
+
+/////////////////////////////////////////////////////////////////////////////
+/*! \brief Search headings and notes of a map in a background thread
+
+    The worker only sees a copy of the texts taken in the GUI thread, so 
+    the map may be edited while searching. Rich text is converted to plain 
+    text by the worker. Results are handed over in 
+    batches, resultsReady() is emitted whenever a new batch is available.
+*/
+class FindWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    struct Entry
+    {
+	uint id;
+	VymText heading;
+	VymText note;
+	QString url;
+	QList <VymText> attributes;
+    };
+
+    struct Result
+    {
+	uint id;
+	QStringList noteHits;	//!< Context of each occurence in note
+    };
+
+    FindWorker (const QString &s, Qt::CaseSensitivity cs, const QList <Entry> &entries, QObject *parent=NULL);
+    void cancel();
+    bool isCanceled();
+    QList <Result> takeResults();
+
+signals:
+    void resultsReady();
+
+protected:
+    void run();
+
+private:
+    QString searchString;
+    Qt::CaseSensitivity caseSensitivity;
+    QList <Entry> entries;
+    QAtomicInt canceled;
+
+    QMutex mutex;	    //!< Protects results
+    QList <Result> results;
+};
+
+#endif
@@ -104,6 +104,7 @@ void FloatImageObj::move (QPointF p)
 void FloatImageObj::positionBBox()
 {
     clickPoly=QPolygonF(bbox);
+    updateSpatialIndex();
     setZValue (dZ_FLOATIMG);
 }
 
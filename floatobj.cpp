@@ -47,6 +47,7 @@ void FloatObj::moveCenter (double x, double y)
     absPos=QPointF(x,y);
     bbox.moveTo(x - bbox.width()/2, y - bbox.height()/2 );
     clickPoly=QPolygonF (bbox);
+    updateSpatialIndex();
 }
 
 void FloatObj::moveCenter2RelPos(double x, double y)  
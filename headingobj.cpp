@@ -1,11 +1,41 @@
 #include <QDebug>
-#include <QRegExp>
+#include <QHash>
 #include <QGraphicsScene>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QTextDocument>
 
 #include "headingobj.h"
 
 extern bool debug;
 
+// Plain headings wrapped already, key is textwidth and text
+static QHash <QString, QStringList> wrapCache;
+static const int wrapCacheMax=10000;
+
+/////////////////////////////////////////////////////////////////
+// HeadingTextItem
+/////////////////////////////////////////////////////////////////
+HeadingTextItem::HeadingTextItem (const QString &text, QGraphicsItem *parent) : QGraphicsTextItem (text, parent)
+{
+}
+
+void HeadingTextItem::paint (QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    // If map is zoomed out, drawing text is expensive and useless
+    qreal lod=QStyleOptionGraphicsItem::levelOfDetailFromTransform (painter->worldTransform() );
+    qreal m=document()->documentMargin();
+    QRectF r=boundingRect().adjusted (m, m, -m, -m);
+    if (r.height() * lod < LOD_MIN_TEXT)
+    {
+	QColor c=defaultTextColor();
+	c.setAlpha (128);
+	painter->fillRect (QRectF (r.x(), r.y() + r.height()/4, r.width(), r.height()/2), c);
+	return;
+    }
+    QGraphicsTextItem::paint (painter, option, widget);
+}
+
 /////////////////////////////////////////////////////////////////
 // HeadingObj
 /////////////////////////////////////////////////////////////////
@@ -28,6 +58,7 @@ void HeadingObj::init()
     color=QColor ("black");
     font=QFont();
     heading="";
+    textlineHtml=false;
     angle=0;	
 }
 
@@ -92,7 +123,7 @@ void HeadingObj::calcBBoxSize()
 
 QGraphicsTextItem* HeadingObj::newLine(QString s)  
 {
-    QGraphicsTextItem *t=new QGraphicsTextItem (s,parentItem());
+    QGraphicsTextItem *t=new HeadingTextItem (s,parentItem());
     t->setFont (font);
     t->setZValue(dZ_TEXT);
     t->setDefaultTextColor(color);
@@ -124,107 +155,163 @@ void HeadingObj::setText (QString s)
 {
     heading=s;
 
-    // remove old textlines and prepare generating new ones
-    while (!textline.isEmpty())
-	delete textline.takeFirst();
-
     if (s.startsWith("<html>")||
 	s.startsWith("<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.0//EN\" \"http://www.w3.org/TR/REC-html40/strict.dtd\">")
     )
-    {
-	QGraphicsTextItem *t=new QGraphicsTextItem ();
-	t->setFont (font);
-	t->setZValue(dZ_TEXT);
-	t->setHtml (s);
-	t->setDefaultTextColor(color);
-	t->setRotation (angle);
-	scene()->addItem (t);
-	textline.append (t);
-    } else
+	setLines (QStringList() << s, true);
+    else
     {
 	// prevent empty textline, so at least a small selection stays
 	// visible for this heading
 	if (s.length()==0) s="  ";
 
-	int i=0;	// index for actual search for ws
-	int j=0;	// index of last ws
-	int k=0;	// index of "<br>" or similar linebreak
-	int br=0;	// width of found break, e.g. for <br> it is 4
-	QRegExp re("<br.*/>");
-	re.setMinimal (true);
+	QString key=QString::number (textwidth) + ":" + s;
+	QHash <QString, QStringList>::const_iterator it=wrapCache.constFind (key);
+	if (it!=wrapCache.constEnd() )
+	    setLines (it.value(), false);
+	else
+	{
+	    QStringList lines=wrap (s, textwidth);
+	    if (wrapCache.size() >= wrapCacheMax) wrapCache.clear();
+	    wrapCache.insert (key, lines);
+	    setLines (lines, false);
+	}
+    } // ASCII heading with multiple lines
+    setVisibility (visible);
+    move (absPos.x(),absPos.y());
+    calcBBoxSize();
+}
+
+void HeadingObj::setLines (const QStringList &lines, bool html)
+{
+    // Existing textlines are reused, so the QTextDocument of a line
+    // only needs to be updated, if its text changed
+    if (html!=textlineHtml)
+    {
+	while (!textline.isEmpty())
+	    delete textline.takeFirst();
+	textlineText.clear();
+	textlineHtml=html;
+    }
+    while (textline.size() > lines.size() )
+    {
+	delete textline.takeLast();
+	textlineText.removeLast();
+    }
+    for (int i=0; i<lines.size(); i++)
+    {
+	if (i<textline.size() )
+	{
+	    QGraphicsTextItem *t=textline.at(i);
+	    if (t->font()!=font) t->setFont (font);
+	    if (textlineText.at(i)==lines.at(i) ) continue;
+	    if (html)
+		t->setHtml (lines.at(i));
+	    else
+		t->setPlainText (lines.at(i));
+	    textlineText[i]=lines.at(i);
+	} else if (html)
+	{
+	    QGraphicsTextItem *t=new HeadingTextItem ();
+	    t->setFont (font);
+	    t->setZValue(dZ_TEXT);
+	    t->setHtml (lines.at(i));
+	    t->setDefaultTextColor(color);
+	    t->setRotation (angle);
+	    scene()->addItem (t);
+	    textline.append (t);
+	    textlineText.append (lines.at(i));
+	} else
+	{
+	    textline.append (newLine (lines.at(i)));
+	    textlineText.append (lines.at(i));
+	}
+    }
+}
+
+QStringList HeadingObj::wrap (QString s, int width)
+{
+    QStringList lines;
+    int i=0;	// index for actual search for ws
+    int j=0;	// index of last ws
+    int k=0;	// index of "<br>" or similar linebreak
+    int e=0;	// index of "/>" closing the linebreak
+    int br=0;	// width of found break, e.g. for <br> it is 4
 
-	// set the text and wrap lines
-	while (s.length()>0)
+    // set the text and wrap lines
+    while (s.length()>0)
+    {
+	// ok, some people wanted manual linebreaks, here we go
+	k=s.indexOf ("<br",i);
+	if (k>=0)
 	{
-	    // ok, some people wanted manual linebreaks, here we go
-	    k=re.indexIn (s,i);
-	    if (k>=0)
-	    {
-		br=re.cap(0).length();
-		i=k;
-	    } else
-		i=s.indexOf (" ",i);
-	    if (i<0 && j==0)
-	    {   // no ws found at all in s
-		// append whole s
-		textline.append (newLine(s));
-		s="";
+	    e=s.indexOf ("/>",k+3);
+	    if (e<0) k=-1;
+	}
+	if (k>=0)
+	{
+	    br=e+2-k;
+	    i=k;
+	} else
+	    i=s.indexOf (" ",i);
+	if (i<0 && j==0)
+	{   // no ws found at all in s
+	    // append whole s
+	    lines.append (s);
+	    s="";
+	} else
+	{
+	    if (i<0 && j>0)
+	    {	// no ws found in actual search
+		if (s.length()<=width)
+		{
+		    lines.append (s);
+		    s="";
+		} else
+		{
+		    lines.append (s.left(j));
+		    s=s.mid(j+1,s.length());
+		    j=0;
+		}	    
 	    } else
 	    {
-		if (i<0 && j>0)
-		{	// no ws found in actual search
-		    if (s.length()<=textwidth)
+		if (i>= 0 && i<=static_cast <int> (width))
+		{   // there is a ws in width
+		    if (br>0)
 		    {
-			textline.append (newLine(s));
-			s="";
+			// here is a linebreak
+			lines.append (s.left(i));
+			s=s.mid(i+br,s.length());
+			i=0;
+			j=0;
+			br=0;
 		    } else
 		    {
-			textline.append (newLine(s.left(j)));
-			s=s.mid(j+1,s.length());
-			j=0;
-		    }	    
+			j=i;
+			i++;
+		    }
 		} else
 		{
-		    if (i>= 0 && i<=static_cast <int> (textwidth))
-		    {   // there is a ws in textwidth
-			if (br>0)
-			{
-			    // here is a linebreak
-			    textline.append (newLine(s.left(i)));
-			    s=s.mid(i+br,s.length());
+		    if (i>static_cast <int> (width)  )
+		    {	
+			if (j>0)
+			{   // a ws out of width, but we have also one in
+			    lines.append (s.left(j));
+			    s=s.mid(j+1,s.length());
 			    i=0;
 			    j=0;
-			    br=0;
 			} else
-			{
-			    j=i;
-			    i++;
-			}
-		    } else
-		    {
-			if (i>static_cast <int> (textwidth)  )
-			{	
-			    if (j>0)
-			    {   // a ws out of textwidth, but we have also one in
-				textline.append (newLine(s.left(j)));
-				s=s.mid(j+1,s.length());
-				i=0;
-				j=0;
-			    } else
-			    {   // a ws out of text, but none in
-				textline.append (newLine(s.left(i)));
-				s=s.mid(i+1,s.length());
-				i=0;
-			    }
+			{   // a ws out of text, but none in
+			    lines.append (s.left(i));
+			    s=s.mid(i+1,s.length());
+			    i=0;
 			}
-		    } 
-		}	  
-	    }	    
-	}
-    } // ASCII heading with multiple lines
-    setVisibility (visible);
-    move (absPos.x(),absPos.y());
-    calcBBoxSize();
+		    }
+		} 
+	    }	  
+	}	    
+    }
+    return lines;
 }
 
 QString HeadingObj::text ()
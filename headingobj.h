@@ -1,8 +1,18 @@
 #ifndef HEADINGOBJ_H
 #define HEADINGOBJ_H
 
+#include <QGraphicsTextItem>
+
 #include "mapobj.h"
 
+/*! \brief Textline of a heading, drawn as bar if too small to be read */
+
+class HeadingTextItem:public QGraphicsTextItem {
+public:
+    HeadingTextItem (const QString &text=QString(), QGraphicsItem *parent=NULL);
+    virtual void paint (QPainter*, const QStyleOptionGraphicsItem*, QWidget*);
+};
+
 /*! \brief The heading of an OrnamentedObj */
 
 class HeadingObj:public MapObj {
@@ -18,6 +28,8 @@ public:
 private:
 //    QGraphicsSimpleTextItem* newLine(QString);		// generate new textline
     QGraphicsTextItem* newLine(QString);		// generate new textline
+    void setLines (const QStringList &lines, bool html);// reuse or create textlines
+    static QStringList wrap (QString s, int width);	// split plain text into lines
 public:    
     virtual void setTransformOriginPoint (const QPointF &);
     virtual void setRotation (qreal const &a);
@@ -41,6 +53,8 @@ protected:
     QString heading;
     int textwidth;								// width for formatting text
     QList <QGraphicsTextItem*> textline;
+    QStringList textlineText;		// text or html currently set in textlines
+    bool textlineHtml;			// textlines contain rich text
     QColor color;
     QFont font;
 };
@@ -1,3 +1,6 @@
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
 #include "imageobj.h"
 #include "mapobj.h"
 
@@ -58,4 +61,13 @@ bool ImageObj::load (const QPixmap &pm)
     return true;
 }
 
+void ImageObj::paint (QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    // Skip flags and images, which would be only a few pixels on screen
+    qreal lod=QStyleOptionGraphicsItem::levelOfDetailFromTransform (painter->worldTransform() );
+    QRectF r=boundingRect();
+    if (qMax (r.width(), r.height() ) * lod < LOD_MIN_ICON) return;
+
+    QGraphicsPixmapItem::paint (painter, option, widget);
+}
 
@@ -17,5 +17,6 @@ public:
     void save (const QString &, const char *);
     bool load (const QString &);
     bool load (const QPixmap &);
+    virtual void paint (QPainter*, const QStyleOptionGraphicsItem*, QWidget*);
 };
 #endif
@@ -2,12 +2,53 @@
 #include <math.h>
 #include <cstdlib>
 
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
 #include "linkablemapobj.h"
 #include "branchobj.h"
 #include "vymmodel.h"
 
 extern bool debug;
 
+/////////////////////////////////////////////////////////////////
+// LinkPolygonItem
+/////////////////////////////////////////////////////////////////
+
+LinkPolygonItem::LinkPolygonItem (bool c)
+{
+    closed=c;
+}
+
+void LinkPolygonItem::paint (QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *)
+{
+    QPolygonF poly=polygon();
+
+    // If map is zoomed out, few points are sufficient. Closed polygons
+    // consist of two parabels, keep both ends of each at the wide parent end
+    qreal lod=QStyleOptionGraphicsItem::levelOfDetailFromTransform (painter->worldTransform() );
+    if (lod < LOD_MIN_LINK && poly.size() > 4)
+    {
+	int half= closed ? poly.size() / 2 : poly.size();
+	QPolygonF simple;
+	for (int h=0; h<poly.size(); h+=half)
+	{
+	    int last=qMin (h + half, poly.size()) - 1;
+	    for (int i=h; i<last; i+=4)
+		simple << poly.at(i);
+	    simple << poly.at(last);
+	}
+	poly=simple;
+    }
+
+    painter->setPen (pen() );
+    painter->setBrush (brush() );
+    if (closed)
+	painter->drawPolygon (poly);
+    else
+	painter->drawPolyline (poly);
+}
+
 /////////////////////////////////////////////////////////////////
 // LinkableMapObj
 /////////////////////////////////////////////////////////////////
@@ -21,7 +62,7 @@ LinkableMapObj::LinkableMapObj(QGraphicsItem* parent, TreeItem *ti) :MapObj(pare
 
 LinkableMapObj::~LinkableMapObj()
 {
-    //qDebug()<< "Destructor LMO  this="<<this<<" style="<<style<<" l="<<l<<"  p="<<p<<"  segment="<<segment.count();
+    //qDebug()<< "Destructor LMO  this="<<this<<" style="<<style<<" l="<<l<<"  p="<<p;
     delLink();
 }
 
@@ -52,7 +93,8 @@ void LinkableMapObj::init ()
 
     topPad=botPad=leftPad=rightPad=0;
 
-    repositionRequest=false;
+    repositionRequest=true;
+    linkGeometryValid=false;
 
     // Rel Positions
     relPos=QPointF(0,0);
@@ -78,7 +120,7 @@ void LinkableMapObj::delLink()
 	    delete (l);
 	    break;
 	case Parabel:
-	    while (!segment.isEmpty()) delete segment.takeFirst();
+	    delete (p);
 	    break;
 	case PolyLine:
 	    delete (p);
@@ -105,6 +147,7 @@ void LinkableMapObj::setParObj(LinkableMapObj* o)
 {
     parObj=o;
     setParentItem (parObj);
+    requestReposition();
 }
 
 void LinkableMapObj::setParObjTmp(LinkableMapObj*,QPointF,int)	
@@ -145,6 +188,7 @@ void LinkableMapObj::setRelPos(const QPointF &p)
 	relPos=p;
 	useRelPos=true;
 	setOrientation();
+	requestReposition();
     }	else
 	qWarning()<<"LMO::setRelPos (p)  parObj==0   this="<<this;
 }
@@ -218,8 +262,8 @@ void LinkableMapObj::setLinkStyle(Style newstyle)
     delLink();
 	
     style=newstyle;
+    linkGeometryValid=false;
 
-    QGraphicsLineItem *cl;
     switch (style)
     {
 	case Line: 
@@ -232,21 +276,22 @@ void LinkableMapObj::setLinkStyle(Style newstyle)
 	    createBottomLine();
 	    break;
 	case Parabel:
-	    for (int i=0;i<arcsegs;i++)
-	    {
-		cl = scene()->addLine(QLineF(i*5,0,i*10,100),pen);
-		cl->setZValue(dZ_LINK);
-		if (visible)
-		    cl->show();
-		else
-		    cl->hide();
-		segment.append(cl);
-	    }
+	    p = new LinkPolygonItem (false);
+	    p->setPen (pen);
+	    scene()->addItem (p);
+	    p->setZValue(dZ_LINK);
+	    if (visible)
+		p->show();
+	    else
+		p->hide();
 	    pa0.resize (arcsegs+1);
 	    createBottomLine();
 	    break;
 	case PolyLine:  
-	    p =scene()->addPolygon(QPolygonF(),pen,linkcolor);
+	    p = new LinkPolygonItem (true);
+	    p->setPen (pen);
+	    p->setBrush (linkcolor);
+	    scene()->addItem (p);
 	    p->setZValue(dZ_LINK);
 	    if (visible)
 		p->show();
@@ -256,7 +301,10 @@ void LinkableMapObj::setLinkStyle(Style newstyle)
 	    createBottomLine();
 	    break;
 	case PolyParabel:	
-	    p = scene()->addPolygon(QPolygonF(),pen,linkcolor);
+	    p = new LinkPolygonItem (true);
+	    p->setPen (pen);
+	    p->setBrush (linkcolor);
+	    scene()->addItem (p);
 	    p->setZValue(dZ_LINK);
 	    if (visible)
 		p->show();
@@ -270,6 +318,9 @@ void LinkableMapObj::setLinkStyle(Style newstyle)
 	default: 
 	    break;	
     }   
+
+    // New link items are drawn during next alignment
+    requestReposition();
 }
 
 LinkableMapObj::Style LinkableMapObj::getLinkStyle()
@@ -307,8 +358,7 @@ void LinkableMapObj::setLinkColor(QColor col)
 	    l->setPen( pen);
 	    break;  
 	case Parabel:	
-	    for (int i=0; i<segment.size(); ++i)
-		segment.at(i)->setPen( pen);
+	    p->setPen( pen);
 	    break;
 	case PolyLine:
 	    p->setBrush( QBrush(col));
@@ -379,8 +429,7 @@ void LinkableMapObj::updateVisibility()
 		if (l) l->show();
 		break;
 	    case Parabel:   
-		for (int i=0; i<segment.size(); ++i)
-		    segment.at(i)->show();
+		if (p) p->show();
 		break;	
 	    case PolyLine:
 		if (p) 
@@ -406,8 +455,7 @@ void LinkableMapObj::updateVisibility()
 		if (l) l->hide();
 		break;
 	    case Parabel:   
-		for (int i=0; i<segment.size(); ++i)
-		    segment.at(i)->hide();
+		if (p) p->hide();
 		break;	
 	    case PolyLine:
 		if (p) p->hide();
@@ -485,9 +533,35 @@ void LinkableMapObj::updateLinkGeometry()
 
     //qDebug()<<"LMO::updateGeo d="<<treeItem->depth()<<"  this="<<this<<"  "<<treeItem->getHeading();
 
+    QPointF p1 (p1x, p1y);
+    QPointF p2 (p2x, p2y);
+    if (linkGeometryValid && z == linkZ)
+    {
+        // Nothing changed, e.g. only children have been moved
+        QPointF v = p1 - linkP1;
+        if (v.isNull() && p2 == linkP2 && childRefPos == linkChildRefPos) 
+            return;
+
+        // Both anchors moved by the same vector, e.g. whole subtree moved
+        if (p2 - linkP2 == v && childRefPos - linkChildRefPos == v)
+        {
+            translateLink (v);
+            linkP1 = p1;
+            linkP2 = p2;
+            linkChildRefPos = childRefPos;
+            return;
+        }
+    }
+    linkP1 = p1;
+    linkP2 = p2;
+    linkChildRefPos = childRefPos;
+    linkZ = z;
+    linkGeometryValid = true;
+
     // Draw the horizontal line below heading (from childRefPos to ParPos)
     if (bottomline) 
     {
+        bottomline->setPos (0,0);
         bottomline->setLine (QLineF (childRefPos.x(), childRefPos.y(), p1x, p1y) );
         bottomline->setZValue (z);
     }
@@ -504,6 +578,7 @@ void LinkableMapObj::updateLinkGeometry()
     switch (style)
     {
     case Line:
+        l->setPos (0,0);
         l->setLine( QLine(qRound (parPos.x()),
                           qRound(parPos.y()),
                           qRound(p2x),
@@ -512,29 +587,30 @@ void LinkableMapObj::updateLinkGeometry()
         break;
     case Parabel:
         parabel (pa0, p1x,p1y,p2x,p2y);
-        for (int i=0; i<segment.size(); ++i)
-        {
-            segment.at(i)->setLine(QLineF( pa0.at(i).x(), pa0.at(i).y(), pa0.at(i + 1).x(),pa0.at(i + 1).y()));
-            segment.at(i)->setZValue (z);
-        }
+        p->setPos (0,0);
+        p->setPolygon(pa0);
+        p->setZValue (z);
         break;
     case PolyLine:
-        pa0.clear();
-        pa0 << QPointF (qRound(p2x + tp.x()), qRound(p2y + tp.y()));
-        pa0 << QPointF (qRound(p2x - tp.x()), qRound(p2y - tp.y()));
-        pa0 << QPointF (qRound (parPos.x()), qRound(parPos.y()) );
-        p->setPolygon(QPolygonF (pa0));
+        pa0.resize (3);
+        pa0[0] = QPointF (qRound(p2x + tp.x()), qRound(p2y + tp.y()));
+        pa0[1] = QPointF (qRound(p2x - tp.x()), qRound(p2y - tp.y()));
+        pa0[2] = QPointF (qRound (parPos.x()), qRound(parPos.y()) );
+        p->setPos (0,0);
+        p->setPolygon(pa0);
         p->setZValue (z);
         break;
     case PolyParabel:
         parabel (pa1, p1x,p1y,p2x+tp.x(),p2y+tp.y());
         parabel (pa2, p1x,p1y,p2x-tp.x(),p2y-tp.y());
-        pa0.clear();
+        pa0.resize (arcsegs*2+2);
         for (int i = 0; i <= arcsegs; i++)
-            pa0 << QPointF (pa1.at(i));
-        for (int i = 0; i<= arcsegs; i++)
-            pa0 << QPointF (pa2.at(arcsegs-i));
-        p->setPolygon(QPolygonF (pa0));
+        {
+            pa0[i] = pa1.at(i);
+            pa0[arcsegs+1+i] = pa2.at(arcsegs-i);
+        }
+        p->setPos (0,0);
+        p->setPolygon(pa0);
         p->setZValue (z);
         break;
     default:
@@ -568,12 +644,16 @@ void LinkableMapObj::reposition()  // virtual
 
 void LinkableMapObj::requestReposition()   
 {
-    if (!repositionRequest)
+    // Mark myself and parental objects as dirty. Parents of dirty 
+    // objects are dirty already, so stop there. Scrolled and hidden 
+    // subtrees are cleaned completely during alignment and marked 
+    // again, when they become visible
+    repositionRequest=true;
+    LinkableMapObj *lmo=parObj;
+    while (lmo && !lmo->repositionRequest)
     {
-	// Pass on the request to parental objects, if this hasn't
-	// been done yet
-	repositionRequest=true;
-	if (parObj) parObj->requestReposition();
+	lmo->repositionRequest=true;
+	lmo=lmo->parObj;
     }
 }
 
@@ -619,15 +699,33 @@ void LinkableMapObj::parabel (QPolygonF &ya, qreal p1x, qreal p1y, qreal p2x, qr
     else    
 	m = (vy / (vx*vx));
     dx = vx/(arcsegs);
-    ya.clear();
-    ya << QPointF (p1x,p1y);
+    ya.resize (arcsegs+1);  // Reuse buffer, size is usually unchanged
+    ya[0] = QPointF (p1x,p1y);
     for (int i=1; i <= arcsegs; i++)
     {	
 	pnx = p1x + dx;
 	pny = m * (pnx - parPos.x()) * (pnx - parPos.x()) + parPos.y();
-	ya << QPointF (pnx, pny);
+	ya[i] = QPointF (pnx, pny);
 	p1x = pnx;
 	p1y = pny;
     }	
 }
 
+void LinkableMapObj::translateLink (const QPointF &v)
+{
+    if (bottomline) bottomline->moveBy (v.x(), v.y() );
+    switch (style)
+    {
+	case Line:
+	    l->moveBy (v.x(), v.y() );
+	    break;
+	case Parabel:
+	case PolyLine:
+	case PolyParabel:
+	    p->moveBy (v.x(), v.y() );
+	    break;
+	default:
+	    break;
+    }
+}
+
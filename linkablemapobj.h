@@ -1,6 +1,8 @@
 #ifndef LINKABLEMAPOBJ_H
 #define LINKABLEMAPOBJ_H
 
+#include <QGraphicsPolygonItem>
+
 #include "animpoint.h"
 #include "vymnote.h"
 #include "headingobj.h"
@@ -11,6 +13,19 @@
 class VymModel;
 class TreeItem;
 
+/*! \brief Polygon of a link, simplified if map is zoomed out
+
+Open polygons are drawn as polyline, e.g. for the Parabel style.
+*/
+
+class LinkPolygonItem:public QGraphicsPolygonItem {
+public:
+    LinkPolygonItem (bool closed);
+    virtual void paint (QPainter*, const QStyleOptionGraphicsItem*, QWidget*);
+private:
+    bool closed;
+};
+
 /*! \brief This class adds links to MapObj 
 
 The links are connecting the branches (BranchObj) and images (FloatImageObj) in the map.
@@ -98,7 +113,7 @@ public:
     Orientation getOrientation();	    // get orientation
 
     virtual void reposition();
-    virtual void requestReposition();	    // do reposition after next user event
+    virtual void requestReposition();	    // mark dirty, reposition after next user event
     virtual void forceReposition();	    // to force a reposition now (outside
     // of mapeditor e.g. in noteeditor
     virtual bool repositionRequested();
@@ -107,6 +122,7 @@ public:
 
 protected:
     void parabel(QPolygonF &, qreal, qreal, qreal, qreal);  // Create Parabel connecting two points
+    void translateLink (const QPointF &v);  // Move drawn link without calculating it again
 
     QPointF childRefPos;
     QPointF floatRefPos;
@@ -127,9 +143,8 @@ protected:
     QColor linkcolor;               // Link color
     QPen pen;
     QGraphicsLineItem* l;           // line style
-    QGraphicsPolygonItem* p;	    // poly styles
+    LinkPolygonItem* p;		    // parabel and poly styles
     int arcsegs;                    // arc: number of segments
-    QList <QGraphicsLineItem*> segment; // a part of e.g. the parabel
     QPolygonF pa0;		    // For drawing of PolyParabel and PolyLine
     QPolygonF pa1;		    // For drawing of PolyParabel
     QPolygonF pa2;		    // For drawing of PolyParabel
@@ -138,7 +153,12 @@ protected:
     bool useBottomline;		    //! Hint if bottomline should be used
     qreal bottomlineY;              // vertical offset of dockpos to pos
 
-    bool repositionRequest;	    //
+    bool repositionRequest;	    // dirty: myself or children need to be aligned
+
+    bool linkGeometryValid;	    // Link has been drawn for the anchors below
+    QPointF linkP1, linkP2;	    // Anchors of drawn link
+    QPointF linkChildRefPos;	    // Start of drawn bottomline
+    int linkZ;
 
     qreal topPad, botPad,
     leftPad, rightPad;          // padding within bbox
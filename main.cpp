@@ -89,7 +89,6 @@ FlagRow *standardFlagsMaster;
 Switchboard switchboard;
 
 Settings settings ("InSilmaril","vym"); // Organization, Application name
-QString zipToolPath;    // Platform dependant zip tool
 
 QList <Command*> modelCommands;
 
@@ -315,12 +314,6 @@ int main(int argc, char* argv[])
     // Platform specific settings
     vymPlatform = QSysInfo::prettyProductName();
 
-#if defined(Q_OS_MACX)
-#elif defined(Q_OS_WIN32)
-    zipToolPath = settings.value("/system/zipToolPath", "c:\\Program Files\\7-Zip\\7z.exe").toString();
-#elif defined(Q_OS_LINUX)
-#else
-#endif
     iconPath=vymBaseDir.path()+"/icons/";
     flagsPath=vymBaseDir.path()+"/flags/";
     macroPath=vymBaseDir.path() + "/macros/";
@@ -403,20 +396,6 @@ int main(int argc, char* argv[])
     Main m;
 #endif
 
-    // Check for zip tools (at least on windows...)
-#if defined(Q_OS_WIN32)
-    QFile zipTool(zipToolPath);
-    if (!zipTool.exists() )
-    {
-        QMessageBox::critical( 0, QObject::tr( "Critical Error" ),
-                               QObject::tr("Couldn't find tool to unzip data. "
-                                           "Please download and install 7z and set "
-                                           "path in Settings menu:\n ") +
-                                           "http://www.7-zip.org/");
-         m.settingsZipTool();
-    }
-#endif
-
     m.setWindowIcon (QPixmap (":/vym.png"));
     m.fileNew();
 
@@ -23,6 +23,7 @@
 #include "aboutdialog.h"
 #include "branchpropeditor.h"
 #include "branchitem.h"
+#include "branchiterator.h"
 #include "command.h"
 #include "downloadagent.h"
 #include "exportoofiledialog.h"
@@ -113,7 +114,6 @@ extern QDir lastMapDir;
 #if defined(Q_OS_WIN32)
 extern QDir vymInstallDir;
 #endif
-extern QString zipToolPath;
 
 Main::Main(QWidget* parent, Qt::WindowFlags f) : QMainWindow(parent,f)
 {
@@ -480,32 +480,35 @@ void Main::closeEvent (QCloseEvent* event)
 // Define commands for models
 void Main::setupAPI()
 {
-    Command *c = new Command ("addBranch",Command::Branch);
+    Command *c = new Command ("abortBatch",Command::Any,VymModel::CmdAbortBatch);
+    modelCommands.append(c);
+
+    c=new Command ("addBranch",Command::Branch,VymModel::CmdAddBranch);
     c->addPar (Command::Int, true, "Index of new branch");
     modelCommands.append(c);
 
-    c=new Command ("addBranchBefore",Command::Branch);
+    c=new Command ("addBranchBefore",Command::Branch,VymModel::CmdAddBranchBefore);
     modelCommands.append(c);
 
-    c=new Command ("addMapCenter",Command::Any);
+    c=new Command ("addMapCenter",Command::Any,VymModel::CmdAddMapCenter);
     c->addPar (Command::Double,false, "Position x");
     c->addPar (Command::Double,false, "Position y");
     modelCommands.append(c);
 
-    c=new Command ("addMapInsert",Command::Any);
+    c=new Command ("addMapInsert",Command::Any,VymModel::CmdAddMapInsert);
     c->addPar (Command::String,false, "Filename of map to load");
     c->addPar (Command::Int,true, "Index where map is inserted");
     c->addPar (Command::Int,true, "Content filter");
     modelCommands.append(c);
 
-    c=new Command ("addMapReplace",Command::Branch);
+    c=new Command ("addMapReplace",Command::Branch,VymModel::CmdAddMapReplace);
     c->addPar (Command::String,false, "Filename of map to load");
     modelCommands.append(c);
 
-    c=new Command ("addSlide",Command::Branch);
+    c=new Command ("addSlide",Command::Branch,VymModel::CmdAddSlide);
     modelCommands.append(c);
 
-    c=new Command ("addXLink",Command::BranchLike);
+    c=new Command ("addXLink",Command::BranchLike,VymModel::CmdAddXLink);
     c->addPar (Command::String, false, "Begin of XLink");
     c->addPar (Command::String, false, "End of XLink");
     c->addPar (Command::Int,    true, "Width of XLink");
@@ -513,445 +516,475 @@ void Main::setupAPI()
     c->addPar (Command::String, true, "Penstyle of XLink");
     modelCommands.append(c);
 
-    c=new Command ("branchCount",Command::Any);
+    c=new Command ("autoLayout",Command::Any,VymModel::CmdAutoLayout);
+    c->addPar (Command::Int,true, "Time budget in milliseconds");
+    modelCommands.append(c);
+
+    c=new Command ("beginBatch",Command::Any,VymModel::CmdBeginBatch);
     modelCommands.append(c);
 
-    c=new Command ("centerCount",Command::BranchLike);
+    c=new Command ("branchCount",Command::Any,VymModel::CmdBranchCount);
     modelCommands.append(c);
 
-    c=new Command ("centerOnID",Command::Any);
+    c=new Command ("centerCount",Command::BranchLike,VymModel::CmdCenterCount);
+    modelCommands.append(c);
+
+    c=new Command ("centerOnID",Command::Any,VymModel::CmdCenterOnID);
     c->addPar (Command::String,false, "UUID of object to center on");
     modelCommands.append(c);
 
-    c=new Command ("clearFlags",Command::BranchLike);
+    c=new Command ("checkItemIndex",Command::Any,VymModel::CmdCheckItemIndex);
+    modelCommands.append(c);
+
+    c=new Command ("clearFlags",Command::BranchLike,VymModel::CmdClearFlags);
     modelCommands.append(c);
 
-    c=new Command ("colorBranch",Command::Branch);
+    c=new Command ("colorBranch",Command::Branch,VymModel::CmdColorBranch);
     c->addPar (Command::Color,true, "New color");
     modelCommands.append(c);
 
-    c=new Command ("colorSubtree",Command::Branch);
+    c=new Command ("colorSubtree",Command::Branch,VymModel::CmdColorSubtree);
     c->addPar (Command::Color,true, "New color");
     modelCommands.append(c);
 
-    c=new Command ("copy",Command::BranchOrImage);
+    c=new Command ("commitBatch",Command::Any,VymModel::CmdCommitBatch);
     modelCommands.append(c);
 
-    c=new Command ("cut",Command::BranchOrImage);
+    c=new Command ("connectToServer",Command::Any,VymModel::CmdConnectToServer);
+    c->addPar (Command::String,true, "Host of server");
+    c->addPar (Command::Int,true, "Port of server");
     modelCommands.append(c);
 
-    c=new Command ("cycleTask",Command::BranchOrImage);
+    c=new Command ("copy",Command::BranchOrImage,VymModel::CmdCopy);
+    modelCommands.append(c);
+
+    c=new Command ("cut",Command::BranchOrImage,VymModel::CmdCut);
+    modelCommands.append(c);
+
+    c=new Command ("cycleTask",Command::BranchOrImage,VymModel::CmdCycleTask);
     c->addPar (Command::Bool,true, "True, if cycling in reverse order");
     modelCommands.append(c);
 
-    c=new Command ("delete",Command::TreeItem);
+    c=new Command ("delete",Command::TreeItem,VymModel::CmdDelete);
     modelCommands.append(c);
 
-    c=new Command ("deleteChildren",Command::Branch);
+    c=new Command ("deleteChildren",Command::Branch,VymModel::CmdDeleteChildren);
     modelCommands.append(c);
 
-    c=new Command ("deleteKeepChildren",Command::Branch);
+    c=new Command ("deleteKeepChildren",Command::Branch,VymModel::CmdDeleteKeepChildren);
     modelCommands.append(c);
 
-    c=new Command ("deleteSlide",Command::Any);
+    c=new Command ("deleteSlide",Command::Any,VymModel::CmdDeleteSlide);
     c->addPar (Command::Int,false,"Index of slide to delete");
     modelCommands.append(c);
 
-    c=new Command ("exportAO",Command::Any);
+    c=new Command ("exportAO",Command::Any,VymModel::CmdExportAO);
     c->addPar (Command::String,false,"Filename for export");
     modelCommands.append(c);
 
-    c=new Command ("exportASCII",Command::Any);
+    c=new Command ("exportASCII",Command::Any,VymModel::CmdExportASCII);
     c->addPar (Command::String,false,"Filename for export");
     c->addPar (Command::Bool,false,"Flag, if tasks should be appended");
     modelCommands.append(c);
 
-    c=new Command ("exportCSV",Command::Any);
+    c=new Command ("exportCSV",Command::Any,VymModel::CmdExportCSV);
     c->addPar (Command::String,false,"Filename for export");
     modelCommands.append(c);
 
-    c=new Command ("exportHTML",Command::Any);
+    c=new Command ("exportHTML",Command::Any,VymModel::CmdExportHTML);
     c->addPar (Command::String,false,"Path used for export");
     c->addPar (Command::String,false,"Filename for export");
     modelCommands.append(c);
 
-    c=new Command ("exportImage",Command::Any);
+    c=new Command ("exportImage",Command::Any,VymModel::CmdExportImage);
     c->addPar (Command::String,false,"Filename for export");
     c->addPar (Command::String,true,"Image format");
     modelCommands.append(c);
 
-    c=new Command ("exportImpress",Command::Any);
+    c=new Command ("exportImpress",Command::Any,VymModel::CmdExportImpress);
     c->addPar (Command::String,false,"Filename for export");
     c->addPar (Command::String,false,"Configuration file for export");
     modelCommands.append(c);
 
-    c=new Command ("exportLast",Command::Any);
+    c=new Command ("exportLast",Command::Any,VymModel::CmdExportLast);
     modelCommands.append(c);
 
-    c=new Command ("exportLaTeX",Command::Any);
+    c=new Command ("exportLaTeX",Command::Any,VymModel::CmdExportLaTeX);
     c->addPar (Command::String,false,"Filename for export");
     modelCommands.append(c);
 
-    c=new Command ("exportOrgMode",Command::Any);
+    c=new Command ("exportOrgMode",Command::Any,VymModel::CmdExportOrgMode);
     c->addPar (Command::String,false,"Filename for export");
     modelCommands.append(c);
 
     modelCommands.append(c);
 
-    c=new Command ("exportPDF",Command::Any);
+    c=new Command ("exportPDF",Command::Any,VymModel::CmdExportPDF);
     c->addPar (Command::String,false,"Filename for export");
     modelCommands.append(c);
 
-    c=new Command ("exportPDF",Command::Any);
+    c=new Command ("exportPDF",Command::Any,VymModel::CmdExportPDF);
     c->addPar (Command::String,false,"Filename for export");
     modelCommands.append(c);
 
-    c=new Command ("exportSVG",Command::Any);
+    c=new Command ("exportSVG",Command::Any,VymModel::CmdExportSVG);
     c->addPar (Command::String,false,"Filename for export");
     modelCommands.append(c);
 
-    c=new Command ("exportXML",Command::Any);
+    c=new Command ("exportXML",Command::Any,VymModel::CmdExportXML);
     c->addPar (Command::String,false,"Path used for export");
     c->addPar (Command::String,false,"Filename for export");
     modelCommands.append(c);
 
-    c=new Command ("getDestPath",Command::Any);
+    c=new Command ("getDestPath",Command::Any,VymModel::CmdGetDestPath);
     modelCommands.append(c);
 
-    c=new Command ("getFileDir",Command::Any);
+    c=new Command ("getFileDir",Command::Any,VymModel::CmdGetFileDir);
     modelCommands.append(c);
 
-    c=new Command ("getFrameType",Command::Branch);
+    c=new Command ("getFrameTime",Command::Any,VymModel::CmdGetFrameTime);
     modelCommands.append(c);
 
-    c=new Command ("getHeadingPlainText",Command::TreeItem);
+    c=new Command ("getFrameType",Command::Branch,VymModel::CmdGetFrameType);
     modelCommands.append(c);
 
-    c=new Command ("getHeadingXML",Command::TreeItem);
+    c=new Command ("getHeadingPlainText",Command::TreeItem,VymModel::CmdGetHeadingPlainText);
     modelCommands.append(c);
 
-    c=new Command ("getMapAuthor",Command::Any);
+    c=new Command ("getHeadingXML",Command::TreeItem,VymModel::CmdGetHeadingXML);
     modelCommands.append(c);
 
-    c=new Command ("getMapComment",Command::Any);
+    c=new Command ("getMapAuthor",Command::Any,VymModel::CmdGetMapAuthor);
     modelCommands.append(c);
 
-    c=new Command ("getMapTitle",Command::Any);
+    c=new Command ("getMapComment",Command::Any,VymModel::CmdGetMapComment);
     modelCommands.append(c);
 
-    c=new Command ("getNotePlainText",Command::TreeItem);
+    c=new Command ("getMapTitle",Command::Any,VymModel::CmdGetMapTitle);
     modelCommands.append(c);
 
-    c=new Command ("getNoteXML",Command::TreeItem);
+    c=new Command ("getNotePlainText",Command::TreeItem,VymModel::CmdGetNotePlainText);
     modelCommands.append(c);
 
-    c=new Command ("getSelectString",Command::TreeItem);
+    c=new Command ("getNoteXML",Command::TreeItem,VymModel::CmdGetNoteXML);
     modelCommands.append(c);
 
-    c=new Command ("getTaskSleepDays",Command::Branch);
+    c=new Command ("getSelectString",Command::TreeItem,VymModel::CmdGetSelectString);
     modelCommands.append(c);
 
-    c=new Command ("getURL",Command::TreeItem); 
+    c=new Command ("getTaskSleepDays",Command::Branch,VymModel::CmdGetTaskSleepDays);
     modelCommands.append(c);
 
-    c=new Command ("getVymLink",Command::Branch); 
+    c=new Command ("getURL",Command::TreeItem,VymModel::CmdGetURL); 
     modelCommands.append(c);
 
-    c=new Command ("getXLinkColor",Command::XLink);
+    c=new Command ("getVymLink",Command::Branch,VymModel::CmdGetVymLink); 
     modelCommands.append(c);
 
-    c=new Command ("getXLinkWidth",Command::XLink);
+    c=new Command ("getXLinkColor",Command::XLink,VymModel::CmdGetXLinkColor);
     modelCommands.append(c);
 
-    c=new Command ("getXLinkPenStyle",Command::XLink);
+    c=new Command ("getXLinkWidth",Command::XLink,VymModel::CmdGetXLinkWidth);
     modelCommands.append(c);
 
-    c=new Command ("getXLinkStyleBegin",Command::XLink);
+    c=new Command ("getXLinkPenStyle",Command::XLink,VymModel::CmdGetXLinkPenStyle);
     modelCommands.append(c);
 
-    c=new Command ("getXLinkStyleEnd",Command::XLink);
+    c=new Command ("getXLinkStyleBegin",Command::XLink,VymModel::CmdGetXLinkStyleBegin);
     modelCommands.append(c);
 
-    c=new Command ("hasActiveFlag",Command::TreeItem);
+    c=new Command ("getXLinkStyleEnd",Command::XLink,VymModel::CmdGetXLinkStyleEnd);
+    modelCommands.append(c);
+
+    c=new Command ("hasActiveFlag",Command::TreeItem,VymModel::CmdHasActiveFlag);
     c->addPar (Command::String,false,"Name of flag");
     modelCommands.append(c);
 
-    c=new Command ("hasNote",Command::Branch); 
+    c=new Command ("hasNote",Command::Branch,VymModel::CmdHasNote); 
     modelCommands.append(c);
 
-    c=new Command ("hasRichTextNote",Command::Branch); 
+    c=new Command ("hasRichTextNote",Command::Branch,VymModel::CmdHasRichTextNote); 
     modelCommands.append(c);
 
-    c=new Command ("hasTask",Command::Branch); 
+    c=new Command ("hasTask",Command::Branch,VymModel::CmdHasTask); 
     modelCommands.append(c);
 
-    c=new Command ("importDir",Command::Branch);
+    c=new Command ("importDir",Command::Branch,VymModel::CmdImportDir);
     c->addPar (Command::String,false,"Directory name to import");
     modelCommands.append(c);
 
-    c=new Command ("isScrolled",Command::Branch); 
+    c=new Command ("isScrolled",Command::Branch,VymModel::CmdIsScrolled); 
     modelCommands.append(c);
 
-    c=new Command ("loadImage",Command::Branch); 
+    c=new Command ("loadImage",Command::Branch,VymModel::CmdLoadImage); 
     c->addPar (Command::String,false,"Filename of image");
     modelCommands.append(c);
 
-    c=new Command ("loadNote",Command::Branch); 
+    c=new Command ("loadNote",Command::Branch,VymModel::CmdLoadNote); 
     c->addPar (Command::String,false,"Filename of note");
     modelCommands.append(c);
 
-    c=new Command ("moveDown",Command::Branch); 
+    c=new Command ("moveDown",Command::Branch,VymModel::CmdMoveDown); 
     modelCommands.append(c);
 
-    c=new Command ("moveUp",Command::Branch); 
+    c=new Command ("moveUp",Command::Branch,VymModel::CmdMoveUp); 
     modelCommands.append(c);
 
-    c=new Command ("moveSlideDown",Command::Any); 
+    c=new Command ("moveSlideDown",Command::Any,VymModel::CmdMoveSlideDown); 
     modelCommands.append(c);
 
-    c=new Command ("moveSlideUp",Command::Any); 
+    c=new Command ("moveSlideUp",Command::Any,VymModel::CmdMoveSlideUp); 
     modelCommands.append(c);
 
-    c=new Command ("move",Command::BranchOrImage); 
+    c=new Command ("move",Command::BranchOrImage,VymModel::CmdMove); 
     c->addPar (Command::Double,false,"Position x");
     c->addPar (Command::Double,false,"Position y");
     modelCommands.append(c);
 
-    c=new Command ("moveRel",Command::BranchOrImage); 
+    c=new Command ("moveRel",Command::BranchOrImage,VymModel::CmdMoveRel); 
     c->addPar (Command::Double,false,"Position x");
     c->addPar (Command::Double,false,"Position y");
     modelCommands.append(c);
 
-    c=new Command ("nop",Command::Any); 
+    c=new Command ("newServer",Command::Any,VymModel::CmdNewServer); 
+    c->addPar (Command::Int,true, "Port to listen on");
     modelCommands.append(c);
 
-    c=new Command ("note2URLs",Command::Branch); 
+    c=new Command ("nop",Command::Any,VymModel::CmdNop); 
+    modelCommands.append(c);
+
+    c=new Command ("note2URLs",Command::Branch,VymModel::CmdNote2URLs); 
     modelCommands.append(c);
 
     //internally required for undo/redo of changing VymText:
-    c=new Command ("parseVymText",Command::Branch);
+    c=new Command ("parseVymText",Command::Branch,VymModel::CmdParseVymText);
     c->addPar (Command::String,false,"parse XML of VymText, e.g for Heading or VymNote");
     modelCommands.append(c);
 
-    c=new Command ("paste",Command::Branch);
+    c=new Command ("paste",Command::Branch,VymModel::CmdPaste);
     modelCommands.append(c);
 
-    c=new Command ("redo",Command::Any); 
+    c=new Command ("redo",Command::Any,VymModel::CmdRedo); 
     modelCommands.append(c);
 
-    c=new Command ("relinkTo",Command::TreeItem);   // FIXME different number of parameters for Image or Branch
+    c=new Command ("relinkTo",Command::TreeItem,VymModel::CmdRelinkTo);   // FIXME different number of parameters for Image or Branch
     c->addPar (Command::String,false,"Selection string of parent");
     c->addPar (Command::Int,false,"Index position");
     c->addPar (Command::Double,true,"Position x");
     c->addPar (Command::Double,true,"Position y");
     modelCommands.append(c);
 
-    c=new Command ("saveImage",Command::Image); 
+    c=new Command ("restoreMap",Command::Any,VymModel::CmdRestoreMap); 
+    c->addPar (Command::String,false,"Filename of map to restore");
+    c->addPar (Command::String,true,"Selection string after restore");
+    modelCommands.append(c);
+
+    c=new Command ("saveImage",Command::Image,VymModel::CmdSaveImage); 
     c->addPar (Command::String,false,"Filename of image to save");
     c->addPar (Command::String,false,"Format of image to save");
     modelCommands.append(c);
 
-    c=new Command ("saveNote",Command::Branch); 
+    c=new Command ("saveNote",Command::Branch,VymModel::CmdSaveNote); 
     c->addPar (Command::String,false,"Filename of note to save");
     modelCommands.append(c);
 
-    c=new Command ("scroll",Command::Branch); 
+    c=new Command ("scroll",Command::Branch,VymModel::CmdScroll); 
     modelCommands.append(c);
 
-    c=new Command ("select",Command::Any); 
+    c=new Command ("select",Command::Any,VymModel::CmdSelect); 
     c->addPar (Command::String,false,"Selection string");
     modelCommands.append(c);
 
-    c=new Command ("selectID",Command::Any); 
+    c=new Command ("selectID",Command::Any,VymModel::CmdSelectID); 
     c->addPar (Command::String,false,"Unique ID");
     modelCommands.append(c);
 
-    c=new Command ("selectLastBranch",Command::Branch); 
+    c=new Command ("selectLastBranch",Command::Branch,VymModel::CmdSelectLastBranch); 
     modelCommands.append(c);
 
-    c=new Command ("selectLastImage",Command::Branch); 
+    c=new Command ("selectLastImage",Command::Branch,VymModel::CmdSelectLastImage); 
     modelCommands.append(c);
 
-    c=new Command ("selectLatestAdded",Command::Any); 
+    c=new Command ("selectLatestAdded",Command::Any,VymModel::CmdSelectLatestAdded); 
     modelCommands.append(c);
 
-    c=new Command ("selectParent",Command::Branch); 
+    c=new Command ("selectParent",Command::Branch,VymModel::CmdSelectParent); 
     modelCommands.append(c);
 
-    c=new Command ("setFlag",Command::TreeItem); 
+    c=new Command ("setFlag",Command::TreeItem,VymModel::CmdSetFlag); 
     c->addPar (Command::String,false,"Name of flag");
     modelCommands.append(c);
 
-    c=new Command ("setTaskSleep",Command::Branch); 
+    c=new Command ("setTaskSleep",Command::Branch,VymModel::CmdSetTaskSleep); 
     c->addPar (Command::String,false,"Days to sleep");
     modelCommands.append(c);
 
-    c=new Command ("setFrameIncludeChildren",Command::BranchOrImage); 
+    c=new Command ("setFrameIncludeChildren",Command::BranchOrImage,VymModel::CmdSetFrameIncludeChildren); 
     c->addPar (Command::Bool,false,"Include or don't include children in frame");
     modelCommands.append(c);
 
-    c=new Command ("setFrameType",Command::BranchOrImage); 
+    c=new Command ("setFrameType",Command::BranchOrImage,VymModel::CmdSetFrameType); 
     c->addPar (Command::String,false,"Type of frame");
     modelCommands.append(c);
 
-    c=new Command ("setFramePenColor",Command::BranchOrImage); 
+    c=new Command ("setFramePenColor",Command::BranchOrImage,VymModel::CmdSetFramePenColor); 
     c->addPar (Command::Color,false,"Color of frame border line");
     modelCommands.append(c);
 
-    c=new Command ("setFrameBrushColor",Command::BranchOrImage); 
+    c=new Command ("setFrameBrushColor",Command::BranchOrImage,VymModel::CmdSetFrameBrushColor); 
     c->addPar (Command::Color,false,"Color of frame background");
     modelCommands.append(c);
 
-    c=new Command ("setFramePadding",Command::BranchOrImage); 
+    c=new Command ("setFramePadding",Command::BranchOrImage,VymModel::CmdSetFramePadding); 
     c->addPar (Command::Int,false,"Padding around frame");
     modelCommands.append(c);
 
-    c=new Command ("setFrameBorderWidth",Command::BranchOrImage); 
+    c=new Command ("setFrameBorderWidth",Command::BranchOrImage,VymModel::CmdSetFrameBorderWidth); 
     c->addPar (Command::Int,false,"Width of frame borderline");
     modelCommands.append(c);
 
-    c=new Command ("setHeadingPlainText",Command::TreeItem); 
+    c=new Command ("setHeadingPlainText",Command::TreeItem,VymModel::CmdSetHeadingPlainText); 
     c->addPar (Command::String,false,"New heading");
     modelCommands.append(c);
 
-    c=new Command ("setHideExport",Command::BranchOrImage); 
+    c=new Command ("setHideExport",Command::BranchOrImage,VymModel::CmdSetHideExport); 
     c->addPar (Command::Bool,false,"Set if item should be visible in export");
     modelCommands.append(c);
 
-    c=new Command ("setIncludeImagesHorizontally",Command::Branch); 
+    c=new Command ("setIncludeImagesHorizontally",Command::Branch,VymModel::CmdSetIncludeImagesHorizontally); 
     c->addPar (Command::Bool,false,"Set if images should be included horizontally in parent branch");
     modelCommands.append(c);
 
-    c=new Command ("setIncludeImagesVertically",Command::Branch); 
+    c=new Command ("setIncludeImagesVertically",Command::Branch,VymModel::CmdSetIncludeImagesVertically); 
     c->addPar (Command::Bool,false,"Set if images should be included vertically in parent branch");
     modelCommands.append(c);
 
-    c=new Command ("setHideLinksUnselected",Command::BranchOrImage); 
+    c=new Command ("setHideLinksUnselected",Command::BranchOrImage,VymModel::CmdSetHideLinkUnselected); 
     c->addPar (Command::Bool,false,"Set if links of items should be visible for unselected items");
     modelCommands.append(c);
 
-    c=new Command ("setMapAnimCurve",Command::Any); 
+    c=new Command ("setMapAnimCurve",Command::Any,VymModel::CmdSetMapAnimCurve); 
     c->addPar (Command::Int,false,"EasingCurve used in animation in MapEditor");
     modelCommands.append(c);
 
-    c=new Command ("setMapAuthor",Command::Any); 
+    c=new Command ("setMapAuthor",Command::Any,VymModel::CmdSetMapAuthor); 
     c->addPar (Command::String,false,"");
     modelCommands.append(c);
 
-    c=new Command ("setMapAnimDuration",Command::Any); 
+    c=new Command ("setMapAnimDuration",Command::Any,VymModel::CmdSetMapAnimDuration); 
     c->addPar (Command::Int,false,"Duration of animation in MapEditor in milliseconds");
     modelCommands.append(c);
 
-    c=new Command ("setMapBackgroundColor",Command::Any); 
+    c=new Command ("setMapBackgroundColor",Command::Any,VymModel::CmdSetMapBackgroundColor); 
     c->addPar (Command::Color,false,"Color of map background");
     modelCommands.append(c);
 
-    c=new Command ("setMapComment",Command::Any); 
+    c=new Command ("setMapComment",Command::Any,VymModel::CmdSetMapComment); 
     c->addPar (Command::String,false,"");
     modelCommands.append(c);
 
-    c=new Command ("setMapTitle",Command::Any); 
+    c=new Command ("setMapTitle",Command::Any,VymModel::CmdSetMapTitle); 
     c->addPar (Command::String,false,"");
     modelCommands.append(c);
 
-    c=new Command ("setMapDefLinkColor",Command::Any); 
+    c=new Command ("setMapDefLinkColor",Command::Any,VymModel::CmdSetMapDefLinkColor); 
     c->addPar (Command::Color,false,"Default color of links");
     modelCommands.append(c);
 
-    c=new Command ("setMapLinkStyle",Command::Any); 
+    c=new Command ("setMapLinkStyle",Command::Any,VymModel::CmdSetMapLinkStyle); 
     c->addPar (Command::String,false,"Link style in map");
     modelCommands.append(c);
 
-    c=new Command ("setMapRotation",Command::Any); 
+    c=new Command ("setMapRotation",Command::Any,VymModel::CmdSetMapRotation); 
     c->addPar (Command::Double,false,"Rotation of map");
     modelCommands.append(c);
 
-    c=new Command ("setMapTitle",Command::Any); 
+    c=new Command ("setMapTitle",Command::Any,VymModel::CmdSetMapTitle); 
     c->addPar (Command::String,false,"");
     modelCommands.append(c);
 
-    c=new Command ("setMapZoom",Command::Any); 
+    c=new Command ("setMapZoom",Command::Any,VymModel::CmdSetMapZoom); 
     c->addPar (Command::Double,false,"Zoomfactor of map");
     modelCommands.append(c);
 
-    c=new Command ("setNotePlainText",Command::Branch); 
+    c=new Command ("setNotePlainText",Command::Branch,VymModel::CmdSetNotePlainText); 
     c->addPar (Command::String,false,"Note of branch");
     modelCommands.append(c);
 
-    c=new Command ("setScale",Command::Image); 
+    c=new Command ("setScale",Command::Image,VymModel::CmdSetScale); 
     c->addPar (Command::Double,false,"Scale image x");
     c->addPar (Command::Double,false,"Scale image y");
     modelCommands.append(c);
 
-    c=new Command ("setSelectionColor",Command::Any); 
+    c=new Command ("setSelectionColor",Command::Any,VymModel::CmdSetSelectionColor); 
     c->addPar (Command::Color,false,"Color of selection box");
     modelCommands.append(c);
 
-    c=new Command ("setURL",Command::TreeItem); 
+    c=new Command ("setURL",Command::TreeItem,VymModel::CmdSetURL); 
     c->addPar (Command::String,false,"URL of TreeItem");
     modelCommands.append(c);
 
-    c=new Command ("setVymLink",Command::Branch); 
+    c=new Command ("setVymLink",Command::Branch,VymModel::CmdSetVymLink); 
     c->addPar (Command::String,false,"Vymlink of branch");
     modelCommands.append(c);
 
-    c=new Command ("setXLinkColor", Command::XLink); 
+    c=new Command ("setXLinkColor",Command::XLink,VymModel::CmdSetXLinkColor); 
     c->addPar (Command::String,false,"Color of xlink");
     modelCommands.append(c);
 
-    c=new Command ("setXLinkLineStyle", Command::XLink); 
+    c=new Command ("setXLinkLineStyle",Command::XLink,VymModel::CmdSetXLinkLineStyle); 
     c->addPar (Command::String,false,"Style of xlink");
     modelCommands.append(c);
 
-    c=new Command ("setXLinkStyleBegin", Command::XLink); 
+    c=new Command ("setXLinkStyleBegin",Command::XLink,VymModel::CmdSetXLinkStyleBegin); 
     c->addPar (Command::String,false,"Style of xlink begin");
     modelCommands.append(c);
 
-    c=new Command ("setXLinkStyleEnd", Command::XLink); 
+    c=new Command ("setXLinkStyleEnd",Command::XLink,VymModel::CmdSetXLinkStyleEnd); 
     c->addPar (Command::String,false,"Style of xlink end");
     modelCommands.append(c);
 
-    c=new Command ("setXLinkWidth", Command::XLink); 
+    c=new Command ("setXLinkWidth",Command::XLink,VymModel::CmdSetXLinkWidth); 
     c->addPar (Command::Int,false,"Width of xlink");
     modelCommands.append(c);
 
-    c=new Command ("sleep",Command::Any); 
+    c=new Command ("sleep",Command::Any,VymModel::CmdSleep); 
     c->addPar (Command::Int,false,"Sleep (seconds)");
     modelCommands.append(c);
 
-    c=new Command ("sortChildren",Command::Branch); 
+    c=new Command ("sortChildren",Command::Branch,VymModel::CmdSortChildren); 
     c->addPar (Command::Bool,true,"Sort children of branch in revers order if set");
     modelCommands.append(c);
 
-    c=new Command ("toggleFlag",Command::Branch); 
+    c=new Command ("toggleFlag",Command::Branch,VymModel::CmdToggleFlag); 
     c->addPar (Command::String,false,"Name of flag to toggle");
     modelCommands.append(c);
 
-    c=new Command ("toggleFrameIncludeChildren",Command::Branch); 
+    c=new Command ("toggleFrameIncludeChildren",Command::Branch,VymModel::CmdToggleFrameIncludeChildren); 
     modelCommands.append(c);
 
-    c=new Command ("toggleScroll",Command::Branch); 
+    c=new Command ("toggleScroll",Command::Branch,VymModel::CmdToggleScroll); 
     modelCommands.append(c);
 
-    c=new Command ("toggleTarget",Command::Branch); 
+    c=new Command ("toggleTarget",Command::Branch,VymModel::CmdToggleTarget); 
     modelCommands.append(c);
 
-    c=new Command ("toggleTask",Command::Branch); 
+    c=new Command ("toggleTask",Command::Branch,VymModel::CmdToggleTask); 
     modelCommands.append(c);
 
-    c=new Command ("undo",Command::Any); 
+    c=new Command ("undo",Command::Any,VymModel::CmdUndo); 
     modelCommands.append(c);
 
-    c=new Command ("unscroll",Command::Branch); 
+    c=new Command ("unscroll",Command::Branch,VymModel::CmdUnscroll); 
     modelCommands.append(c);
 
-    c=new Command ("unscrollChildren",Command::Branch); 
+    c=new Command ("unscrollChildren",Command::Branch,VymModel::CmdUnscrollChildren); 
     modelCommands.append(c);
 
-    c=new Command ("unselectAll",Command::Any); 
+    c=new Command ("unselectAll",Command::Any,VymModel::CmdUnselectAll); 
     modelCommands.append(c);
 
-    c=new Command ("unsetFlag",Command::Branch); 
+    c=new Command ("unsetFlag",Command::Branch,VymModel::CmdUnsetFlag); 
     c->addPar (Command::String,false,"Name of flag to unset");
     modelCommands.append(c);
 }
@@ -2538,10 +2571,6 @@ void Main::setupSettingsActions()
     connect( a, SIGNAL( triggered() ), this, SLOT( settingsURL() ) );
     settingsMenu->addAction (a);
 
-    a = new QAction( tr( "Set application to zip/unzip files","Settings action"), this);
-    connect( a, SIGNAL( triggered() ), this, SLOT( settingsZipTool() ) );
-    settingsMenu->addAction (a);
-
     a = new QAction( tr( "Set path for macros","Settings action")+"...", this);
     connect( a, SIGNAL( triggered() ), this, SLOT( settingsMacroDir() ) );
     settingsMenu->addAction (a);
@@ -3102,6 +3131,17 @@ void Main::updateTabName( VymModel *vm)
 void Main::editorChanged()
 {
     VymModel *vm=currentModel();
+
+    // Results of a background search belong to the previous map
+    VymModel *owner=findResultWidget->getResultModel()->getOwner();
+    if (owner && owner!=vm)
+    {
+	owner->findAllCancel();
+	findResultWidget->getResultModel()->clear();
+	findResultWidget->getResultModel()->setOwner (NULL);
+	findResultWidget->setStatus (FindWidget::Undefined);
+    }
+
     if (vm) 
     {	
 	updateNoteEditor (vm->getSelectedIndex() );
@@ -4292,16 +4332,14 @@ void Main::editMapProperties()
     uint f  = 0;
     uint n  = 0;
     uint xl = 0;
-    BranchItem *cur  = NULL;
-    BranchItem *prev = NULL;
-    m->nextBranch(cur, prev);
-    while (cur) 
+    BranchIterator it (m->getRootItem() );
+    while (it.hasNext() )
     {
+        BranchItem *cur=it.next();
         if (!cur->getNote().isEmpty() ) n++;
         f += cur->imageCount();
         b++;
         xl += cur->xlinkCount();
-        m->nextBranch(cur,prev);
     }
 
     stats += QString ("%1 %2\n").arg (m->branchCount(),6).arg(tr("branches","Info about map") );
@@ -4729,13 +4767,28 @@ void Main::editFindNext(QString s)
     VymModel *m=currentModel();
     if (m) 
     {
-	if (m->findAll (findResultWidget->getResultModel(),s,cs) )
-	    findResultWidget->setStatus (FindWidget::Success);
-	else
-	    findResultWidget->setStatus (FindWidget::Failed);
+	if (s.isEmpty() )
+	{
+	    m->findAllCancel();
+	    findResultWidget->getResultModel()->clear();
+	    findResultWidget->setStatus (FindWidget::Undefined);
+	    return;
+	}
+	connect (m, SIGNAL (findAllFinished (bool) ), 
+	    this, SLOT (editFindFinished (bool) ), Qt::UniqueConnection);
+	m->findAllStart (findResultWidget->getResultModel(),s,cs);
     }
 }
 
+void Main::editFindFinished(bool hit)
+{
+    if (sender()!=currentModel() ) return;
+    if (hit)
+	findResultWidget->setStatus (FindWidget::Success);
+    else
+	findResultWidget->setStatus (FindWidget::Failed);
+}
+
 void Main::editFindDuplicateURLs() //FIXME-4 feature: use FindResultWidget for display
 {
     VymModel *m=currentModel();
@@ -4931,13 +4984,15 @@ void Main::viewCenter()
 void Main::networkStartServer()
 {
     VymModel *m=currentModel();
-    if (m) m->newServer();
+    if (m && !m->newServer() )
+	QMessageBox::critical (this, "vym server", tr("Unable to start the server."));
 }
 
 void Main::networkConnect()
 {
     VymModel *m=currentModel();
-    if (m) m->connectToServer();
+    if (m && !m->connectToServer() )
+	QMessageBox::critical (this, "vym client", tr("Unable to connect to server."));
 }
 
 void Main::downloadFinished()   // only used for drop events in mapeditor and VM::downloadImage 
@@ -4989,38 +5044,6 @@ bool Main::settingsURL()
     return ok;
 }
 
-void Main::settingsZipTool()
-{
-    // Default zip tool is 7z on windows, zip/unzip elsewhere
-    bool ok = false;
-
-#if defined(Q_OS_WIN32)
-    QString filter;
-    filter = "Windows executable (*.exe);;";
-
-    QString fn = QFileDialog::getOpenFileName( 
-        this,
-        vymName + " - " + tr("Set application to zip/unzip files") + ":", 
-        zipToolPath,
-        filter);
-
-    if (!fn.isEmpty() ) ok = true;
-
-#else
-
-    QString fn = QInputDialog::getText(
-                this,
-                vymName, tr("Set application to zip/unzip files")+":", QLineEdit::Normal,
-                zipToolPath, &ok);
-#endif
-
-    if (ok)
-    {
-        zipToolPath = fn;
-        settings.setValue ("/system/zipToolPath", zipToolPath);
-    }
-}
-
 void Main::settingsMacroDir()
 {
     QDir defdir(vymBaseDir.path() + "/macros");
@@ -5626,6 +5649,23 @@ void Main::updateActions()
 	if (selbis.count()>0 )
 	    actionFormatColorBranch->setEnabled (true);
 
+	// While a script or D-Bus client holds a batch, changes would 
+	// be neither in history nor in the batch. Treat map as readonly
+	if (m->isBatchActive() )
+	{
+	    standardFlagsMaster->setEnabled (false);
+	    foreach (QAction *a, restrictedMapActions)
+		a->setEnabled (false);
+	    for (int i=0; i<actionListBranches.size(); ++i) 
+		actionListBranches.at(i)->setEnabled(false);
+	    for (int i=0; i<actionListItems.size(); ++i) 
+		actionListItems.at(i)->setEnabled(false);
+	    actionDelete->setEnabled (false);
+	    actionDeleteChildren->setEnabled (false);
+	    actionFormatColorBranch->setEnabled (false);
+	    actionUndo->setEnabled (false);
+	    actionRedo->setEnabled (false);
+	}
     } else
     {
         // No map available 
@@ -5733,30 +5773,6 @@ void Main::testFunction1()
         m->getMapEditor()->minimizeView();
     }
     */
-
-    /*
-    QString zp = "c:\\Program Files\\7-Zip\\7z.exe";
-    QString zipName = "c:\\Users\\uwdr9542\\x\\ü1.vym";
-    QString zipDir  = "c:\\Users\\uwdr9542\\x\\y\\";
-    */
-    QString zp = "c:/Program Files/7-Zip/7z.exe";
-    QString zipName = "c:/Users/uwdr9542/x/ü1.vym";
-    QString zipDir  = "c:/Users/uwdr9542/x/y/";
-
-    zp = QDir::toNativeSeparators(zp);
-    zipName = QDir::toNativeSeparators(zipName);
-    zipDir  = QDir::toNativeSeparators(zipDir);
-    QStringList args;
-    args << "a" << zipName << "-tzip" << "-scsUTF-8" << "-sccUTF-8" << "*" ;
-
-    VymProcess *zipProc=new VymProcess ();
-    zipProc->setWorkingDirectory (zipDir);
-
-    zipProc->start(zipToolPath, args);
-    qDebug() << "7z:" << zp;
-    qDebug() << "7z started in dir: " << zipProc->workingDirectory();
-    qDebug() << "args:" << args;
-    qDebug() << zipProc->getStdout()<<flush;
 }
 
 void Main::testFunction2()
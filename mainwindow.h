@@ -215,6 +215,7 @@ private slots:
     void editSelectNothing();
     void editOpenFindResultWidget();
     void editFindNext(QString s);
+    void editFindFinished(bool hit);
     void editFindDuplicateURLs();
 
 public slots:
@@ -252,7 +253,6 @@ public slots:
     void downloadFinished();
     bool settingsPDF();
     bool settingsURL();
-    void settingsZipTool();
     void settingsMacroDir();
     void settingsUndoLevels();
 
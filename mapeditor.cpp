@@ -1,5 +1,6 @@
 #include "mapeditor.h"
 
+#include <QElapsedTimer>
 #include <QGraphicsProxyWidget>
 #include <QMenuBar>
 #include <QObject>
@@ -8,10 +9,12 @@
 #include <QScrollBar>
 
 #include "branchitem.h"
+#include "branchiterator.h"
 #include "geometry.h"
 #include "mainwindow.h"
 #include "misc.h"
 #include "shortcuts.h"
+#include "spatialindex.h"
 #include "warningdialog.h"
 #include "xlinkitem.h"
 
@@ -605,11 +608,20 @@ void MapEditor::setSmoothPixmap(bool b)
     setRenderHint(QPainter::SmoothPixmapTransform,b);
 }
 
-void MapEditor::autoLayout()
+qreal MapEditor::getFrameTime()
 {
-    // Create list with all bounding polygons
+    QElapsedTimer timer;
+    timer.start();
+    viewport()->repaint();
+    return timer.nsecsElapsed() / 1000000.0;
+}
+
+int MapEditor::autoLayout (int msecs)
+{
+    // Create list with all bounding polygons of mapcenters and main branches
     QList <LinkableMapObj*> mapobjects;
     QList <ConvexPolygon> polys; 
+    QList <QRectF> rects;	// bounding rects of polys for broad phase
     ConvexPolygon p;
     QList <Vector> vectors;
     QList <Vector> orgpos;
@@ -619,126 +631,182 @@ void MapEditor::autoLayout()
     BranchItem *bi2;
     BranchObj *bo;
 
-    // Outer loop: Iterate until we no more changes in orientation 
-    bool orientationChanged=true;
-    while (orientationChanged)
+    BranchItem *ri=model->getRootItem();
+    for (int i=0;i<ri->branchCount();++i)
     {
-	BranchItem *ri=model->getRootItem();
-	for (int i=0;i<ri->branchCount();++i)
+	bi=ri->getBranchNum (i);
+	bo=(BranchObj*)bi->getLMO();
+	if (bo)
 	{
-	    bi=ri->getBranchNum (i);
-	    bo=(BranchObj*)bi->getLMO();
+	    mapobjects.append (bo);
+	    p=bo->getBoundingPolygon();
+	    p.calcCentroid();
+	    polys.append(p);
+	    rects.append (p.boundingRect() );
+	    vectors.append (QPointF(0,0));
+	    orgpos.append (p.at(0));
+	    headings.append (bi->getHeadingPlain());
+	}
+	for (int j=0;j<bi->branchCount();++j)
+	{
+	    bi2=bi->getBranchNum (j);
+	    bo=(BranchObj*)bi2->getLMO();
 	    if (bo)
 	    {
 		mapobjects.append (bo);
 		p=bo->getBoundingPolygon();
 		p.calcCentroid();
 		polys.append(p);
+		rects.append (p.boundingRect() );
 		vectors.append (QPointF(0,0));
 		orgpos.append (p.at(0));
-        headings.append (bi->getHeadingPlain());
-	    }
-	    for (int j=0;j<bi->branchCount();++j)
-	    {
-		bi2=bi->getBranchNum (j);
-		bo=(BranchObj*)bi2->getLMO();
-		if (bo)
-		{
-		    mapobjects.append (bo);
-		    p=bo->getBoundingPolygon();
-		    p.calcCentroid();
-		    polys.append(p);
-		    vectors.append (QPointF(0,0));
-		    orgpos.append (p.at(0));
-            headings.append (bi2->getHeadingPlain());
-		}   
-	    }
+		headings.append (bi2->getHeadingPlain());
+	    }   
 	}
+    }
+
+    // Iterate moving bounding polygons until we have no more collisions
+    // or run out of iterations or time. Collisions are always counted 
+    // for the final positions, even if time is up already
+    const int maxIterations=200;
+    QElapsedTimer timer;
+    timer.start();
+    QList < QPair <qreal,int> > sorted;
+    QList <int> active;
+    int collisions=0;
+    int iterations=0;
+    while (true)
+    {
+	collisions=0;
 
-	// Iterate moving bounding polygons until we have no more collisions
-	int collisions=1;
-	while (collisions>0)
+	// Broad phase: Sweep from left to right, only polygons 
+	// overlapping horizontally and vertically are tested
+	sorted.clear();
+	for (int i=0; i<rects.size(); ++i)
+	    sorted.append (qMakePair (rects.at(i).left(), i) );
+	qSort (sorted);
+
+	active.clear();
+	for (int k=0; k<sorted.size(); ++k)
 	{
-	    collisions=0;
-	    for (int i=0; i<polys.size()-1; ++i)
+	    int j=sorted.at(k).second;
+	    int a=0;
+	    while (a<active.size() )
 	    {
-		for (int j=i+1; j<polys.size();++j)
+		int i=active.at(a);
+		if (rects.at(i).right() < rects.at(j).left() )
+		{
+		    active.removeAt (a);
+		    continue;
+		}
+		a++;
+		if (rects.at(i).bottom() < rects.at(j).top() || 
+		    rects.at(j).bottom() < rects.at(i).top() ) continue;
+
+		if (polygonCollision (polys.at(i),polys.at(j), QPointF(0,0)).intersect )
 		{
-		    if (polygonCollision (polys.at(i),polys.at(j), QPointF(0,0)).intersect )
+		    collisions++;
+		    if (debug) qDebug() << "Collision: "<<headings[i]<<" - "<<headings[j];
+		    v=polys.at(j).centroid()-polys.at(i).centroid();
+		    v.normalize();
+		    // Add direction depending on the pair, if polygons have 
+		    // identical y or x. Golden angle spreads directions evenly
+		    if (v.x()==0 || v.y()==0) 
 		    {
-			collisions++;
-			if (debug) qDebug() << "Collision: "<<headings[i]<<" - "<<headings[j];
-			v=polys.at(j).centroid()-polys.at(i).centroid();
+			qreal phi=(qMin (i,j) * polys.size() + qMax (i,j) + 1) * 2.39996;
+			Vector w (cos (phi), sin (phi));
+			v=v+w;
 			v.normalize();
-			// Add random direction, if only two polygons with identical y or x
-			if (v.x()==0 || v.y()==0) 
-			{
-			    Vector w (cos (double((int)rand()%1000)),sin(double((int)rand()%1000)));
-			    w.normalize();
-			    v=v+w;
-			}
-			
-			// Scale translation vector by area of polygons
-			vectors[j]=v*10000/polys.at(j).weight();	
-			vectors[i]=v*10000/polys.at(i).weight();	
-			vectors[i].invert();
-			//FIXME-3 outer loop, "i" get's changed several times...
-			// Better not move away from centroid of 2 colliding polys, 
-			// but from centroid of _all_
-		    }  
-		}
-	    }
-	    for (int i=0;i<vectors.size();i++)
-	    {
-		//qDebug() << " v="<<vectors[i]<<" "<<headings[i];
-		if (!vectors[i].isNull() )
-		polys[i].translate (vectors[i]);
+		    }
+		    
+		    // Scale translation vector by area of polygons
+		    vectors[j]=vectors[j] + v*10000/qMax (polys.at(j).weight(), qreal(1));
+		    vectors[i]=vectors[i] - v*10000/qMax (polys.at(i).weight(), qreal(1));
+		}  
 	    }
-        // if (debug) qDebug()<< "Collisions total: "<<collisions;
-        // collisions=0;
-	}   
+	    active.append (j);
+	}
+
+	if (collisions==0 || iterations>=maxIterations || 
+	    (msecs>0 && timer.elapsed() > msecs) ) break;
+	iterations++;
 
-	// Finally move the real objects and update 
-	QList <LinkableMapObj::Orientation> orients;
-	for (int i=0;i<polys.size();i++)
+	for (int i=0;i<vectors.size();i++)
 	{
-	    Vector v=polys[i].at(0)-orgpos[i];
-	    orients.append (mapobjects[i]->getOrientation());
-	    if (!v.isNull())
+	    if (!vectors[i].isNull() )
 	    {
-		if (debug) qDebug()<<" Moving "<<polys.at(i).weight()<<" "<<mapobjects[i]->getAbsPos()<<" -> "<<mapobjects[i]->getAbsPos() + v<<"  "<<headings[i];
-		//mapobjects[i]->moveBy(v.x(),v.y() );
-		//mapobjects[i]->setRelPos();
-		model->startAnimation ((BranchObj*)mapobjects[i], v);
-		if (debug) qDebug()<<i<< " Weight: "<<polys.at(i).weight()<<" "<<v<<" "<<headings.at(i);
-	    }
-	}   
-	/*
-	model->reposition();	
-	orientationChanged=false;
-	for (int i=0;i<polys.size();i++)
-	    if (orients[i]!=mapobjects[i]->getOrientation())
-	    {
-		orientationChanged=true;
-		break;
+		polys[i].translate (vectors[i]);
+		rects[i].translate (vectors[i]);
+		vectors[i]=QPointF(0,0);
 	    }
-	*/
-    
-	break;
+	}
+    }   
+    if (debug) qDebug()<< "MapEditor::autoLayout iterations="<<iterations<<" collisions="<<collisions<<" time="<<timer.elapsed();
 
-	//orientationChanged=false;
-    } // loop if orientation has changed
+    // Finally move the real objects and update 
+    for (int i=0;i<polys.size();i++)
+    {
+	Vector v=polys[i].at(0)-orgpos[i];
+	if (!v.isNull())
+	{
+	    if (debug) qDebug()<<" Moving "<<polys.at(i).weight()<<" "<<mapobjects[i]->getAbsPos()<<" -> "<<mapobjects[i]->getAbsPos() + v<<"  "<<headings[i];
+	    model->startAnimation ((BranchObj*)mapobjects[i], v);
+	}
+    }   
 
     model->emitSelectionChanged();
+    return collisions;
+}
+
+// Search order of BranchItem::findMapItem: Branches are found before
+// images of the same parent, both before their parent. Attributes are 
+// found after their parent.
+static int foundRank (TreeItem *ti)
+{
+    if (ti->isBranchLikeType() ) return 0;
+    if (ti->getType()==TreeItem::Image) return 1;
+    return 2;
+}
+
+static bool foundBefore (TreeItem *a, TreeItem *b)
+{
+    TreeItem *pa=a;
+    TreeItem *pb=b;
+    TreeItem *ca=NULL;	    // child of b on the way to a
+    TreeItem *cb=NULL;	    // child of a on the way to b
+    while (pa->depth() > pb->depth() ) 
+    {
+	ca=pa;
+	pa=pa->parent();
+    }
+    if (pa==b) return foundRank (ca) < 2;
+    while (pb->depth() > pa->depth() ) 
+    {
+	cb=pb;
+	pb=pb->parent();
+    }
+    if (pb==a) return foundRank (cb) == 2;
+
+    while (pa->parent()!=pb->parent() )
+    {
+	pa=pa->parent();
+	pb=pb->parent();
+    }
+    if (foundRank (pa) != foundRank (pb) ) 
+	return foundRank (pa) < foundRank (pb);
+    return pa->row() < pb->row();
 }
 
 TreeItem* MapEditor::findMapItem (QPointF p,TreeItem *exclude)
 {
+    // Only items with an area containing p are candidates
+    QList <TreeItem*> candidates=model->getSpatialIndex()->itemsAt (p);
+
     // Search XLinks
-    Link *link;
-    for (int i=0; i<model->xlinkCount(); i++ )
+    foreach (TreeItem *ti, candidates)
     {
-	link=model->getXLinkNum(i);
+	if (ti->getType()!=TreeItem::XLink) continue;
+	Link *link=((XLinkItem*)ti)->getLink();
 	if (link)
 	{
 	    XLinkObj *xlo=link->getXLinkObj();
@@ -755,19 +823,21 @@ TreeItem* MapEditor::findMapItem (QPointF p,TreeItem *exclude)
 	}
     }
 
-    // Search branches (and their childs, e.g. images
-    // Start with mapcenter, no images allowed at rootItem
-    int i=0;
-    BranchItem *bi=model->getRootItem()->getFirstBranch();
+    // Search branches, images and attributes. If objects overlap, 
+    // return the one BranchItem::findMapItem would find first
     TreeItem *found=NULL;
-    while (bi)
+    foreach (TreeItem *ti, candidates)
     {
-	found=bi->findMapItem (p, exclude);
-	if (found) return found;
-	i++;
-	bi=model->getRootItem()->getBranchNum(i);
+	if (ti==exclude || ti->getType()==TreeItem::XLink) continue;
+	if ( (ti->getType()==TreeItem::Image || ti->getType()==TreeItem::Attribute) && 
+	    ti->parent()==exclude) continue;
+
+	MapObj *mo=((MapItem*)ti)->getMO();
+	if (mo && mo->isVisibleObj() && mo->isInClickBox (p) &&
+	    (!found || foundBefore (ti, found) ) )
+	    found=ti;
     }
-    return NULL;
+    return found;
 }
 
 AttributeTable* MapEditor::attributeTable()
@@ -796,11 +866,10 @@ void MapEditor::toggleWinter()
         winter=new Winter (this);
         QList <QRectF> obstacles;
         BranchObj *bo;
-        BranchItem *cur=NULL;
-        BranchItem *prev=NULL;
-        model->nextBranch(cur,prev);
-        while (cur) 
+        BranchIterator it (model->getRootItem() );
+        while (it.hasNext() )
         {
+            BranchItem *cur=it.next();
             if (!cur->hasHiddenExportParent())
             {
                 // Branches
@@ -808,7 +877,6 @@ void MapEditor::toggleWinter()
                 if (bo && bo->isVisibleObj())
                     obstacles.append(bo->getBBox());
             }
-            model->nextBranch(cur,prev);
         }
         winter->setObstacles(obstacles);
     }
@@ -2091,11 +2159,10 @@ void MapEditor::updateData (const QModelIndex &sel)
     {
         QList <QRectF> obstacles;
         BranchObj *bo;
-        BranchItem *cur=NULL;
-        BranchItem *prev=NULL;
-        model->nextBranch(cur,prev);
-        while (cur) 
+        BranchIterator it (model->getRootItem() );
+        while (it.hasNext() )
         {
+            BranchItem *cur=it.next();
             if (!cur->hasHiddenExportParent())
             {
                 // Branches
@@ -2103,7 +2170,6 @@ void MapEditor::updateData (const QModelIndex &sel)
                 if (bo && bo->isVisibleObj())
                     obstacles.append(bo->getBBox());
             }
-            model->nextBranch(cur,prev);
         }
         winter->setObstacles(obstacles);
     }
@@ -125,8 +125,9 @@ public:
     QImage getImage (QPointF &offset);	//!< Get a pixmap of the map
     void setAntiAlias (bool);	    //!< Set or unset antialiasing
     void setSmoothPixmap(bool);	    //!< Set or unset smoothing of pixmaps
+    qreal getFrameTime();	    //!< Time in ms to repaint the visible part of map
 public slots:	
-    void autoLayout();		    //!< Auto layout of map by using collision detection
+    int autoLayout (int msecs=0);   //!< Move branches apart by collision detection, within msecs if >0. Returns remaining collisions
     void testFunction1();		//! just testing new stuff
     void testFunction2();		//! just testing new stuff
 
@@ -1,8 +1,11 @@
 #include <QDebug>
 
 #include "geometry.h"
+#include "mapitem.h"
 #include "mapobj.h"
 #include "misc.h"
+#include "spatialindex.h"
+#include "vymmodel.h"
 
 /////////////////////////////////////////////////////////////////
 // MapObj
@@ -95,6 +98,7 @@ void MapObj::moveBy (double x, double y)
     MapObj::move (absPos + v );
     bbox.moveTo (bbox.topLeft() + v);
     clickPoly.translate (v);
+    updateSpatialIndex();
 }
 
 QRectF MapObj::boundingRect () const 
@@ -168,3 +172,17 @@ void MapObj::setVisibility(bool v)
 
 void MapObj::positionBBox() {}
 void MapObj::calcBBoxSize() {}
+
+void MapObj::updateSpatialIndex()
+{
+    // Only the object representing a branch, image or attribute, not e.g. its flags
+    if (!treeItem) return;
+    if (!treeItem->isBranchLikeType() && 
+	treeItem->getType()!=TreeItem::Image && 
+	treeItem->getType()!=TreeItem::Attribute) return;
+    if ( ((MapItem*)treeItem)->getMO()!=this) return;
+
+    VymModel *model=treeItem->getModel();
+    if (model && model->getSpatialIndex() )
+	model->getSpatialIndex()->update (treeItem, clickPoly.boundingRect() );
+}
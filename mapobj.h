@@ -17,6 +17,11 @@
 #define  Z_INIT      9999
 #define  Z_LINEEDIT 10000 
 
+// Level of detail, sizes in pixels on screen
+#define LOD_MIN_TEXT    5   // Lower textlines are drawn as bars
+#define LOD_MIN_ICON    4   // Smaller flags and images are not drawn
+#define LOD_MIN_LINK  0.5   // Below this zoom links are simplified
+
 class ConvexPolygon;
 
 #include "treeitem.h"
@@ -62,6 +67,8 @@ public:
     virtual void calcBBoxSize();
 
 protected:  
+    void updateSpatialIndex();		//! Store clickPoly in index of model for hit testing
+
     QRectF bbox;		    // bounding box of MO itself
     QPolygonF clickPoly;		    // area where mouseclicks are found
     QPointF absPos;		    // Position on canvas
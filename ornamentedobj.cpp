@@ -213,6 +213,7 @@ void OrnamentedObj::positionContents()
 
     ornamentsBBox.moveTopLeft ( QPointF (ox+x,oy+y));
     clickPoly=QPolygonF (ornamentsBBox);
+    updateSpatialIndex();
 
     // Update bboxTotal coordinate (size set already)
     if (orientation==LinkableMapObj::LeftOfCenter )
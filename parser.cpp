@@ -1,6 +1,8 @@
 #include "parser.h"
 
 #include <QDebug>
+#include <QHash>
+#include <QSet>
 #include <QRegExp>
 #include <iostream>
 
@@ -9,6 +11,57 @@
 
 extern QList <Command*> modelCommands;
 
+// Registered commands by name, rebuilt if modelCommands changed
+static QHash <QString, Command*> commandHash;
+static int commandHashSize=-1;
+
+static Command* findCommand (const QString &name)
+{
+    if (commandHashSize!=modelCommands.size() )
+    {
+	commandHash.clear();
+	foreach (Command *c, modelCommands)
+	    // First registration wins, as with a linear search
+	    if (!commandHash.contains (c->getName() ) )
+		commandHash.insert (c->getName(), c);
+	commandHashSize=modelCommands.size();
+    }
+    return commandHash.value (name, NULL);
+}
+
+// Parsed atoms and scripts, so that repeated scripts (macros, slides, 
+// undo/redo) are not parsed again. Parameters are decoded when an
+// atom has been checked the first time. Only strings used the second
+// time are cached, so one-off imports or atoms with whole notes are 
+// not kept in memory. Caches are limited by their total length.
+struct ParsedAtom
+{
+    QString com;
+    Command *command;
+    QStringList paramList;
+    QList <QVariant> parValues;
+};
+
+static QHash <QString, ParsedAtom> atomCache;	    // key is atom 
+static QHash <QString, QStringList> scriptCache;    // atoms by script
+static int atomCacheLength=0;
+static int scriptCacheLength=0;
+static QSet <uint> atomsSeen;			    // hashes of strings used once
+static QSet <uint> scriptsSeen;
+static const int parserCacheMaxLength=1000000;	    // total chars in a cache
+static const int parserCacheMaxItem=10000;	    // longer strings are not cached
+static const int parserSeenMax=100000;
+
+static bool cacheWanted (QSet <uint> &seen, const QString &s)
+{
+    if (s.length() > parserCacheMaxItem) return false;
+    uint h=qHash (s);
+    if (seen.contains (h) ) return true;
+    if (seen.size() >= parserSeenMax) seen.clear();
+    seen.insert (h);
+    return false;
+}
+
 Parser::Parser()
 {
     initParser();
@@ -24,7 +77,9 @@ void Parser::initAtom()
 {
     atom="";
     com="";
+    command=NULL;
     paramList.clear();
+    parValues.clear();
     errLevel=NoError;
     errDescription="";
     errMessage="";
@@ -33,8 +88,6 @@ void Parser::initAtom()
 void Parser::parseAtom (QString s)
 {
     initAtom();
-    QRegExp re;
-    int pos;
 
     // Strip WS at beginning
     while (s.length() > 0 && (
@@ -45,11 +98,23 @@ void Parser::parseAtom (QString s)
     if (s.length() == 0)
         return;
 
-    // Get command
-    re.setPattern ("^(\\w*)");
-    pos=re.indexIn (s);
-    if (pos>=0)
-	com=re.cap(1);
+    QHash <QString, ParsedAtom>::const_iterator it=atomCache.constFind (s);
+    if (it!=atomCache.constEnd() )
+    {
+	com=it.value().com;
+	command=it.value().command;
+	paramList=it.value().paramList;
+	parValues=it.value().parValues;
+	atom=s;
+	return;
+    }
+
+    // Get command, the leading word characters
+    int n=0;
+    while (n < s.length() && (s.at(n).isLetterOrNumber() || s.at(n).isMark() || s.at(n)=='_') )
+	n++;
+    com=s.left(n);
+    command=findCommand (com);
 
     // Get parameters
     paramList.clear();
@@ -60,6 +125,22 @@ void Parser::parseAtom (QString s)
 
     paramList = findParameters(t);
     atom = s;
+
+    if (errLevel==NoError && cacheWanted (atomsSeen, atom) )
+    {
+	// Parameters are about as long as the atom itself
+	atomCacheLength+=2 * atom.length();
+	if (atomCacheLength > parserCacheMaxLength) 
+	{
+	    atomCache.clear();
+	    atomCacheLength=2 * atom.length();
+	}
+	ParsedAtom pa;
+	pa.com=com;
+	pa.command=command;
+	pa.paramList=paramList;
+	atomCache.insert (atom, pa);
+    }
 }
 
 QString Parser::getAtom()
@@ -72,6 +153,11 @@ QString Parser::getCommand()
     return com;
 }
 
+Command* Parser::getCommandObj()
+{
+    return command;
+}
+
 QStringList Parser::getParameters()
 {
     return paramList;
@@ -114,115 +200,129 @@ void Parser::setError(ErrorLevel level, const QString &description)
 
 bool Parser::checkParameters(TreeItem *selti)
 {
-    foreach (Command *c, modelCommands)
+    Command *c=command;
+    if (c)
     {
-	if (c->getName() == com)
+	// Check type of selection
+	if (selti)
 	{
-	    // Check type of selection
-	    if (selti)
+	    bool ok;
+	    ok=false;
+	    TreeItem::Type st=selti->getType();
+	    Command::SelectionType ct=c->getSelectionType();
+	    if (ct==Command::TreeItem || ct==Command::BranchOrImage)
 	    {
-		bool ok;
-		ok=false;
-		TreeItem::Type st=selti->getType();
-		Command::SelectionType ct=c->getSelectionType();
-		if (ct==Command::TreeItem || ct==Command::BranchOrImage)
-		{
-		    if (st==TreeItem::MapCenter ||
-			st==TreeItem::Branch ||
-			st==TreeItem::XLink ||
-			st==TreeItem::Image ) 
-			ok=true;
-		} else if ( ct==Command::BranchOrImage )
-		{
-		    if (st==TreeItem::MapCenter ||
-			st==TreeItem::Branch ||
-			st==TreeItem::Image ) 
-			ok=true;
-		} else if ( ct==Command::Branch || ct==Command::BranchLike)
-		{
-
-		    if (st == TreeItem::MapCenter ||
-			st == TreeItem::Branch )
-			ok=true;
-		} else if ( ct==Command::Image )	    
-		{
-		    if (st==TreeItem::Image )
-			ok=true;
-		} else if ( ct==Command::Any)	    
-		{
+		if (st==TreeItem::MapCenter ||
+		    st==TreeItem::Branch ||
+		    st==TreeItem::XLink ||
+		    st==TreeItem::Image ) 
 		    ok=true;
-		} else if ( ct==Command::XLink)	    
-		{
-		    if (st==TreeItem::XLink)
-			ok=true;
-		} else
-		    qWarning()<<"Parser::checkParameters  Unknown selection type";
-		if (!ok)
-		{
-		    setError (Aborted, "Selection does not match command");
-		    return false;
-	    	}
-	    }
+	    } else if ( ct==Command::BranchOrImage )
+	    {
+		if (st==TreeItem::MapCenter ||
+		    st==TreeItem::Branch ||
+		    st==TreeItem::Image ) 
+		    ok=true;
+	    } else if ( ct==Command::Branch || ct==Command::BranchLike)
+	    {
 
-	    // Check for number of parameters
-	    int optPars=0;
-	    for (int i=0; i < c->parCount(); i++ )
-		if (c->isParOptional(i) ) optPars++;
-	    if (paramList.count() < (c->parCount() - optPars) ||
-	        paramList.count() > c->parCount() )
+		if (st == TreeItem::MapCenter ||
+		    st == TreeItem::Branch )
+		    ok=true;
+	    } else if ( ct==Command::Image )	    
 	    {
-		QString expected;
-		if (optPars>0)
-		    expected=QString("%1..%2").arg(c->parCount()-optPars).arg(c->parCount() );
-		else 
-		    expected=QString().setNum(c->parCount());
-		setError (
-		    Aborted,
-		    QString("Wrong number of parameters: Expected %1, but found %2").arg(expected).arg(paramList.count()));
+		if (st==TreeItem::Image )
+		    ok=true;
+	    } else if ( ct==Command::Any)	    
+	    {
+		ok=true;
+	    } else if ( ct==Command::XLink)	    
+	    {
+		if (st==TreeItem::XLink)
+		    ok=true;
+	    } else
+		qWarning()<<"Parser::checkParameters  Unknown selection type";
+	    if (!ok)
+	    {
+		setError (Aborted, "Selection does not match command");
 		return false;
 	    }
+	}
+
+	// Check for number of parameters
+	int optPars=0;
+	for (int i=0; i < c->parCount(); i++ )
+	    if (c->isParOptional(i) ) optPars++;
+	if (paramList.count() < (c->parCount() - optPars) ||
+	    paramList.count() > c->parCount() )
+	{
+	    QString expected;
+	    if (optPars>0)
+		expected=QString("%1..%2").arg(c->parCount()-optPars).arg(c->parCount() );
+	    else 
+		expected=QString().setNum(c->parCount());
+	    setError (
+		Aborted,
+		QString("Wrong number of parameters: Expected %1, but found %2").arg(expected).arg(paramList.count()));
+	    return false;
+	}
 
-	    // Check types of parameters
-	    bool ok;
-	    for (int i=0; i < paramList.count(); i++ )
-	    {	
-		switch (c->getParType(i) )
-		{
-		    case Command::String:
-			parString (ok,i);
-                        if (!ok) 
-                        {
-                            // Convert to string implicitly
-                            paramList[i]='"' + paramList[i] + '"';
-                            ok=true;
-                        }
-			break;
-		    case Command::Int:	
-			parInt (ok,i);
-			break;
-		    case Command::Double:	
-			parDouble (ok,i);
-			break;
-		    case Command::Color:	
-			parColor (ok,i);
-			break;
-		    case Command::Bool:	
-			parBool (ok,i);
-			break;
-		    default: ok=false;	
-		}
-		if (!ok)
-		{
-		    setError (
-			Aborted, 
-			QString("Parameter %1 has wrong type").arg(i));
-		    return false;
-		}
-	    }
+	// Parameters have been decoded already for this atom
+	if (parValues.count()==paramList.count() )
+	{
 	    resetError();
 	    return true;
-	}    
-    } 
+	}
+
+	// Check types of parameters and keep decoded values
+	bool ok;
+	QVariant v;
+	for (int i=0; i < paramList.count(); i++ )
+	{	
+	    switch (c->getParType(i) )
+	    {
+		case Command::String:
+		    v=parString (ok,i);
+		    if (!ok) 
+		    {
+			// Convert to string implicitly
+			v=paramList[i];
+			paramList[i]='"' + paramList[i] + '"';
+			ok=true;
+		    }
+		    break;
+		case Command::Int:	
+		    v=parInt (ok,i);
+		    break;
+		case Command::Double:	
+		    v=parDouble (ok,i);
+		    break;
+		case Command::Color:	
+		    v=parColor (ok,i);
+		    break;
+		case Command::Bool:	
+		    v=parBool (ok,i);
+		    break;
+		default: ok=false;	
+	    }
+	    if (!ok)
+	    {
+		setError (
+		    Aborted, 
+		    QString("Parameter %1 has wrong type").arg(i));
+		return false;
+	    }
+	    parValues.append (v);
+	}
+	QHash <QString, ParsedAtom>::iterator it=atomCache.find (atom);
+	if (it!=atomCache.end() )
+	{
+	    it.value().paramList=paramList;
+	    it.value().parValues=parValues;
+	}
+	resetError();
+	return true;
+    }
     setError (Aborted,"Unknown command");
     return false;
 }
@@ -294,6 +394,11 @@ bool Parser::checkParIsDouble(const int &index)
 
 int Parser::parInt (bool &ok,const uint &index)
 {
+    if ((int)index < parValues.count() && parValues.at(index).type()==QVariant::Int)
+    {
+	ok=true;
+	return parValues.at(index).toInt();
+    }
     if (checkParIsInt (index))
 	return paramList[index].toInt (&ok, 10);
     ok=false;
@@ -302,8 +407,12 @@ int Parser::parInt (bool &ok,const uint &index)
 
 QString Parser::parString (bool &ok, const int &index)
 {
-    // return the string at index, this could be also stored in
-    // a variable later
+    // return the string at index, decoded already by checkParameters
+    if (index < parValues.count() && parValues.at(index).type()==QVariant::String)
+    {
+	ok=true;
+	return parValues.at(index).toString();
+    }
     
     // Try to find out if string boundaries are "" or ''
     QRegExp rx;
@@ -346,8 +455,12 @@ QString Parser::parString (bool &ok, const int &index)
 
 bool Parser::parBool (bool &ok,const int &index)
 {
-    // return the bool at index, this could be also stored in
-    // a variable later
+    // return the bool at index
+    if (index < parValues.count() && parValues.at(index).type()==QVariant::Bool)
+    {
+	ok=true;
+	return parValues.at(index).toBool();
+    }
     QString r;
     ok=true;
     QString p=paramList[index];
@@ -362,6 +475,11 @@ bool Parser::parBool (bool &ok,const int &index)
 QColor Parser::parColor(bool &ok,const int &index)
 {
     // return the QColor at index
+    if (index < parValues.count() && parValues.at(index).type()==QVariant::Color)
+    {
+	ok=true;
+	return parValues.at(index).value<QColor>();
+    }
     ok = false;
     QString r;
     QColor c;
@@ -381,6 +499,11 @@ QColor Parser::parColor(bool &ok,const int &index)
 
 double Parser::parDouble (bool &ok,const int &index)
 {
+    if (index < parValues.count() && parValues.at(index).type()==QVariant::Double)
+    {
+	ok=true;
+	return parValues.at(index).toDouble();
+    }
     if (checkParIsDouble (index))
 	return paramList[index].toDouble (&ok);
     ok=false;
@@ -397,6 +520,31 @@ QString Parser::getScript()
     return script;
 }   
 
+QStringList Parser::compile (const QString &s)
+{
+    QHash <QString, QStringList>::const_iterator it=scriptCache.constFind (s);
+    if (it!=scriptCache.constEnd() ) return it.value();
+
+    // Split script into atoms once, parsed atoms are cached, too
+    QStringList atoms;
+    setScript (s);
+    execute();
+    while (next() )
+	atoms.append (atom);
+
+    if (cacheWanted (scriptsSeen, s) )
+    {
+	scriptCacheLength+=2 * s.length();
+	if (scriptCacheLength > parserCacheMaxLength) 
+	{
+	    scriptCache.clear();
+	    scriptCacheLength=2 * s.length();
+	}
+	scriptCache.insert (s, atoms);
+    }
+    return atoms;
+}
+
 void Parser::execute()
 {
     current=0;
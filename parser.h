@@ -3,6 +3,7 @@
 
 #include <QColor>
 #include <QStringList>
+#include <QVariant>
 
 enum ErrorLevel {NoError,Warning,Aborted};
 
@@ -16,6 +17,7 @@ public:
     void parseAtom (QString input);
     QString getAtom();
     QString getCommand();
+    Command* getCommandObj();	    //!< Registered command, NULL if unknown
     QStringList getParameters();
     int parCount();
     QString errorMessage();
@@ -37,6 +39,7 @@ public:
     QString getScript();
     void execute();
     bool next();
+    QStringList compile (const QString &script);    //!< Atoms of script, cached by script
 
     QStringList getCommands(); 
 
@@ -56,6 +59,8 @@ private:
     QString atom;
     QString com;
     QStringList paramList;
+    Command *command;		    // resolved once per atom
+    QList <QVariant> parValues;	    // decoded by checkParameters
     int current;
     QString script;
 
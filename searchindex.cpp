@@ -0,0 +1,131 @@
+#include "searchindex.h"
+
+#include "attributeitem.h"
+#include "branchitem.h"
+#include "vymmodel.h"
+
+SearchIndex::SearchIndex (VymModel *m)
+{
+    model=m;
+}
+
+void SearchIndex::clear()
+{
+    postings.clear();
+    itemWords.clear();
+    dirty.clear();
+}
+
+void SearchIndex::itemChanged (TreeItem *ti)
+{
+    if (!ti) return;
+    if (ti->getType()==TreeItem::Attribute) 
+    {
+	ti=ti->parent();
+	if (!ti) return;
+    }
+    if (ti->isBranchLikeType() ) dirty.insert (ti->getID() );
+}
+
+void SearchIndex::itemRemoved (TreeItem *ti)
+{
+    if (ti->getType()==TreeItem::Attribute)
+	itemChanged (ti);
+    else
+    {
+	dirty.remove (ti->getID() );
+	removeWords (ti->getID() );
+    }
+}
+
+bool SearchIndex::find (const QString &s, QSet <uint> &ids)
+{
+    ids.clear();
+    QStringList query=words (s);
+    if (query.isEmpty() ) return false;
+
+    update();
+
+    for (int i=0; i<query.count(); i++)
+    {
+	// Collect all items with a word containing query word
+	QSet <uint> hits;
+	const QString &q=query.at(i);
+	QHash <QString, QSet <uint> >::const_iterator it;
+	for (it=postings.constBegin(); it!=postings.constEnd(); ++it)
+	    if (it.key().contains (q) ) hits.unite (it.value() );
+	if (i==0)
+	    ids=hits;
+	else
+	    ids.intersect (hits);
+	if (ids.isEmpty() ) break;
+    }
+    return true;
+}
+
+QString SearchIndex::searchText (BranchItem *bi)
+{
+    QString s=bi->getHeading().getTextASCII();
+    s+='\n';
+    s+=bi->getNoteASCII();
+    s+='\n';
+    s+=bi->getURL();
+    for (int i=0; i<bi->attributeCount(); i++)
+    {
+	s+='\n';
+	s+=bi->getAttributeNum(i)->getHeading().getTextASCII();
+    }
+    return s;
+}
+
+QStringList SearchIndex::words (const QString &s)
+{
+    QStringList list;
+    QString w;
+    const QChar *c=s.constData();
+    const QChar *end=c + s.length();
+    for (; c<=end; c++)
+    {
+	if (c<end && c->isLetterOrNumber() )
+	    w+=c->toLower();
+	else if (!w.isEmpty() )
+	{
+	    list.append (w);
+	    w.clear();
+	}
+    }
+    list.removeDuplicates();
+    return list;
+}
+
+void SearchIndex::update()
+{
+    foreach (uint id, dirty)
+    {
+	removeWords (id);
+	TreeItem *ti=model->findID (id);
+	if (!ti || !ti->isBranchLikeType() ) continue;
+
+	QStringList list=words (searchText ((BranchItem*)ti) );
+	foreach (QString w, list)
+	    postings[w].insert (id);
+	itemWords.insert (id, list);
+    }
+    dirty.clear();
+}
+
+void SearchIndex::removeWords (uint id)
+{
+    QHash <uint, QStringList>::iterator it=itemWords.find (id);
+    if (it==itemWords.end() ) return;
+    foreach (QString w, it.value() )
+    {
+	QHash <QString, QSet <uint> >::iterator p=postings.find (w);
+	if (p!=postings.end() )
+	{
+	    p.value().remove (id);
+	    if (p.value().isEmpty() ) postings.erase (p);
+	}
+    }
+    itemWords.erase (it);
+}
@@ -0,0 +1,46 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+class BranchItem;
+class TreeItem;
+class VymModel;
+
+/////////////////////////////////////////////////////////////////////////////
+/*! \brief Inverted index of words in headings, notes, URLs and attributes
+
+    Words are stored in lower case and map to the IDs of the branches
+    containing them. Changed branches are only collected and indexed again 
+    before the next query, so typing or loading a map stays cheap.
+
+    A query matches branches, which contain all words of the query 
+    somewhere within their words, case insensitive. So also text inside 
+    a word is found. Only the distinct words are scanned, not the texts.
+    Callers then check the candidates for the exact search string.
+*/
+class SearchIndex
+{
+public:
+    SearchIndex (VymModel *m);
+    void clear();
+    void itemChanged (TreeItem *ti);	//!< Text of item changed, attributes update their branch
+    void itemRemoved (TreeItem *ti);
+    bool find (const QString &s, QSet <uint> &ids);  //!< false, if s has no words to look up
+
+    static QString searchText (BranchItem *bi);	//!< All text of branch which is indexed
+    static QStringList words (const QString &s);    //!< Lowercase words in s
+
+private:
+    void update();
+    void removeWords (uint id);
+
+    VymModel *model;
+    QHash <QString, QSet <uint> > postings;
+    QHash <uint, QStringList> itemWords;
+    QSet <uint> dirty;
+};
+
+#endif
@@ -1,6 +1,8 @@
 #include <iostream>
 
 #include <QDebug>
+#include <QFile>
+#include <QTextStream>
 
 #include <qregexp.h>
 #include "settings.h"
@@ -22,6 +24,10 @@ void SimpleSettings::clear()
 {
     keylist.clear();
     valuelist.clear();
+    keyIndex.clear();
+    logPath.clear();
+    logLines=0;
+    changedKeys.clear();
 }
 
 bool SimpleSettings::readSettings (const QString &path)
@@ -38,9 +44,9 @@ bool SimpleSettings::readSettings (const QString &path)
     QStringList::Iterator it=lines.begin();
     while (it !=lines.end() )
     {
+	// Later lines (appended by writeSettings) overwrite earlier ones
 	i=(*it).indexOf("=",0);
-	keylist.append((*it).left(i));
-	valuelist.append((*it).right((*it).length()-i-1));
+	setValue ((*it).left(i), (*it).right((*it).length()-i-1));
 	it++;
     }
     return true;
@@ -48,11 +54,28 @@ bool SimpleSettings::readSettings (const QString &path)
 
 void SimpleSettings::writeSettings (const QString &path)
 {
+    if (path==logPath && QFile::exists (path) && 
+	logLines + changedKeys.count() <= 2 * keylist.count() + 16)
+    {
+	// Only append changed values
+	QFile file(path);
+	if (file.open(QFile::WriteOnly | QFile::Append)) 
+	{
+	    QTextStream out(&file);
+	    out.setCodec("UTF-8");
+	    foreach (int i, changedKeys)
+		out << keylist.at(i) << "=" << valuelist.at(i) << "\n";
+	    logLines+=changedKeys.count();
+	    changedKeys.clear();
+	    return;
+	}
+    }
+
+    // Compact: Write all values
     QString s;
     QStringList::Iterator itk=keylist.begin();
     QStringList::Iterator itv=valuelist.begin();
 
-    // First search for value in settings saved in map
     while (itk !=keylist.end() )
     {
 	s+=*itk+"="+*itv+"\n";
@@ -60,94 +83,58 @@ void SimpleSettings::writeSettings (const QString &path)
 	itv++;
     }
     if (!saveStringToDisk(path,s)) 
-	qWarning ()<<"SimpleSettings::writeSettings() Couldn't write "+path;
-}
-
-/*
-QString SimpleSettings::readValue (const QString &key)
-{
-    QStringList::Iterator itk=keylist.begin();
-    QStringList::Iterator itv=valuelist.begin();
-
-    // First search for value in settings saved in map
-    while (itk !=keylist.end() )
     {
-	if (*itk == key)
-	    return *itv;
-	itk++;
-	itv++;
+	qWarning ()<<"SimpleSettings::writeSettings() Couldn't write "+path;
+	logPath.clear();
+	return;
     }
-    qWarning ("SimpleSettings::readValue()  Couldn't find key "+key);
-    return "";
+    logPath=path;
+    logLines=keylist.count();
+    changedKeys.clear();
 }
-*/
 
 QString SimpleSettings::value (const QString &key, const QString &def)
 {
-    QStringList::Iterator itk=keylist.begin();
-    QStringList::Iterator itv=valuelist.begin();
-
-    // First search for value in settings saved in map
-    while (itk !=keylist.end() )
-    {
-	if (*itk == key)
-	    return *itv;
-	itk++;
-	itv++;
-    }
-    return def;
+    QHash <QString,int>::const_iterator it=keyIndex.constFind (key);
+    if (it==keyIndex.constEnd() ) return def;
+    return valuelist.at (it.value() );
 }
 
 int SimpleSettings::readNumValue (const QString &key, const int &def)
 {
-    QStringList::Iterator itk=keylist.begin();
-    QStringList::Iterator itv=valuelist.begin();
+    QHash <QString,int>::const_iterator it=keyIndex.constFind (key);
+    if (it==keyIndex.constEnd() ) return def;
 
-    // First search for value in settings saved in map
-    while (itk !=keylist.end() )
-    {
-	if (*itk == key)
-	{
-	    bool ok;
-	    int i=(*itv).toInt(&ok,10);
-	    if (ok)
-		return i;
-	    else
-		return def;
-	}   
-	itk++;
-	itv++;
-    }
-    return def;
+    bool ok;
+    int i=valuelist.at (it.value() ).toInt(&ok,10);
+    if (ok)
+	return i;
+    else
+	return def;
 }
 
 void SimpleSettings::setValue (const QString &key, const QString &value)
 {
-    QStringList::Iterator itk=keylist.begin();
-    QStringList::Iterator itv=valuelist.begin();
+    if (key.isEmpty() ) return;
 
-    if (!key.isEmpty() )
+    // Search for existing Value first
+    QHash <QString,int>::const_iterator it=keyIndex.constFind (key);
+    if (it!=keyIndex.constEnd() )
     {
-	// Search for existing Value first
-	while (itk !=keylist.end() )
+	int i=it.value();
+	if (valuelist.at(i)!=value)
 	{
-	    if (*itk == key)
-	    {
-		if (!value.isEmpty())
-		    *itv=value;
-		else
-		    *itv="";
-		*itv=value;
-		return;
-	    }
-	    itk++;
-	    itv++;
+	    valuelist[i]=value;
+	    changedKeys.insert (i);
 	}
-	
-	// If no Value exists, append a new one
-	keylist.append (key);
-	valuelist.append (value);
+	return;
     }
+	
+    // If no Value exists, append a new one
+    keyIndex.insert (key, keylist.count() );
+    changedKeys.insert (keylist.count() );
+    keylist.append (key);
+    valuelist.append (value);
 }
 
 
@@ -1,6 +1,8 @@
 #ifndef SETTINGS_H
 #define SETTINGS_H
 
+#include <qhash.h>
+#include <qset.h>
 #include <qsettings.h>
 #include <qstring.h>
 #include <qstringlist.h>
@@ -22,8 +24,15 @@ public:
     int readNumValue (const QString &, const int &def=0);
     void setValue (const QString &,const QString &);
 private:    
-    QStringList keylist;
+    QStringList keylist;	    // keep order of insertion for writeSettings
     QStringList valuelist;
+    QHash <QString,int> keyIndex;   // position of key in keylist
+
+    // writeSettings only appends changes to the file written last,
+    // the file is compacted when it grows too much
+    QString logPath;
+    int logLines;
+    QSet <int> changedKeys;
 };
 
 
@@ -0,0 +1,106 @@
+#include <math.h>
+
+#include "spatialindex.h"
+
+static const qreal cellSize=128;    // Roughly the size of a branch
+static const int maxCells=64;	    // More cells and item is checked always
+
+SpatialIndex::SpatialIndex()
+{
+}
+
+void SpatialIndex::clear()
+{
+    cells.clear();
+    largeItems.clear();
+    itemRects.clear();
+    itemCells.clear();
+}
+
+void SpatialIndex::update (TreeItem *ti, const QRectF &r)
+{
+    QRect c=cellRange (r);
+    bool large=c.width() * c.height() > maxCells;
+    if (large) c=QRect();
+
+    QHash <TreeItem*, QRect>::iterator it=itemCells.find (ti);
+    if (it!=itemCells.end() )
+    {
+	// Still in same cells, e.g. only size changed
+	if (it.value()==c)
+	{
+	    itemRects[ti]=r;
+	    return;
+	}
+	if (it.value().isNull() )
+	    largeItems.removeAll (ti);
+	else
+	    removeCells (ti, it.value() );
+    }
+
+    itemRects[ti]=r;
+    itemCells[ti]=c;
+    if (large)
+	largeItems.append (ti);
+    else
+	insertCells (ti, c);
+}
+
+void SpatialIndex::remove (TreeItem *ti)
+{
+    QHash <TreeItem*, QRect>::iterator it=itemCells.find (ti);
+    if (it==itemCells.end() ) return;
+
+    if (it.value().isNull() )
+	largeItems.removeAll (ti);
+    else
+	removeCells (ti, it.value() );
+    itemCells.erase (it);
+    itemRects.remove (ti);
+}
+
+QList <TreeItem*> SpatialIndex::itemsAt (const QPointF &p)
+{
+    QList <TreeItem*> list;
+    QHash <quint64, QList <TreeItem*> >::const_iterator it=cells.constFind (
+	cellKey ( (int)floor (p.x() / cellSize), (int)floor (p.y() / cellSize) ) );
+    if (it!=cells.constEnd() )
+	foreach (TreeItem *ti, it.value() )
+	    if (itemRects.value (ti).contains (p) ) list.append (ti);
+
+    foreach (TreeItem *ti, largeItems)
+	if (itemRects.value (ti).contains (p) ) list.append (ti);
+    return list;
+}
+
+QRect SpatialIndex::cellRange (const QRectF &r)
+{
+    QRectF n=r.normalized();
+    return QRect (
+	QPoint ( (int)floor (n.left()   / cellSize), (int)floor (n.top()    / cellSize) ),
+	QPoint ( (int)floor (n.right()  / cellSize), (int)floor (n.bottom() / cellSize) ) );
+}
+
+void SpatialIndex::insertCells (TreeItem *ti, const QRect &c)
+{
+    for (int x=c.left(); x<=c.right(); x++)
+	for (int y=c.top(); y<=c.bottom(); y++)
+	    cells[cellKey (x,y)].append (ti);
+}
+
+void SpatialIndex::removeCells (TreeItem *ti, const QRect &c)
+{
+    for (int x=c.left(); x<=c.right(); x++)
+	for (int y=c.top(); y<=c.bottom(); y++)
+	{
+	    QHash <quint64, QList <TreeItem*> >::iterator it=cells.find (cellKey (x,y) );
+	    if (it==cells.end() ) continue;
+	    it.value().removeOne (ti);
+	    if (it.value().isEmpty() ) cells.erase (it);
+	}
+}
+
+quint64 SpatialIndex::cellKey (int x, int y)
+{
+    return ( (quint64)(quint32)x << 32) | (quint32)y;
+}
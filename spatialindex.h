@@ -0,0 +1,44 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QRect>
+#include <QRectF>
+
+class TreeItem;
+
+/////////////////////////////////////////////////////////////////////////////
+/*! \brief Uniform grid over the click areas of branches, images and xlinks
+
+    Each item is stored in all grid cells covered by its bounding
+    rectangle, items covering very many cells (e.g. long xlinks) are kept
+    in a separate list. Objects update their rectangle whenever they are
+    moved, so looking up a point only needs to check the items of a
+    single cell instead of the whole map.
+
+    Rectangles may be outdated for hidden or scrolled objects, callers
+    have to check visibility and the exact click area of the candidates.
+*/
+class SpatialIndex
+{
+public:
+    SpatialIndex();
+    void clear();
+    void update (TreeItem *ti, const QRectF &r);    //!< Set area of item
+    void remove (TreeItem *ti);
+    QList <TreeItem*> itemsAt (const QPointF &p);   //!< Items with area containing p
+
+private:
+    QRect cellRange (const QRectF &r);
+    void insertCells (TreeItem *ti, const QRect &cells);
+    void removeCells (TreeItem *ti, const QRect &cells);
+    static quint64 cellKey (int x, int y);
+
+    QHash <quint64, QList <TreeItem*> > cells;
+    QList <TreeItem*> largeItems;	    //!< Items covering too many cells
+    QHash <TreeItem*, QRectF> itemRects;
+    QHash <TreeItem*, QRect> itemCells;	    //!< Covered cells, null for large items
+};
+
+#endif
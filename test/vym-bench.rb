@@ -0,0 +1,216 @@
+#!/usr/bin/env ruby
+
+# Benchmarks for a running vym instance. Start vym e.g. with
+#
+#   vym -l -t -n bench test/default.vym demos/*.vym &
+#   test/vym-bench.rb -d /tmp/vym-bench
+#
+# and compare the numbers between two builds of vym.
+
+require "#{ENV['PWD']}/scripts/vym-ruby"
+require 'benchmark'
+require 'fileutils'
+require 'optparse'
+
+instance_name = 'bench'
+
+options = { :testdir => '/tmp/vym-bench', :runs => 10, :mapdir => nil, :levels => 5, :lines => 100000 }
+OptionParser.new do |opts|
+  opts.banner = "Usage: vym-bench.rb [options]"
+
+  opts.on('-d', '--directory  NAME', 'Directory name') { |s| options[:testdir] = s }
+  opts.on('-r', '--runs N', Integer, 'Number of runs per benchmark') { |n| options[:runs] = n }
+  opts.on('-m', '--maps DIR', 'Directory with maps for load benchmark') { |s| options[:mapdir] = s }
+  opts.on('-l', '--levels N', Integer, 'Levels of synthetic map for tree walk, 0 to skip') { |n| options[:levels] = n }
+  opts.on('-s', '--script-lines N', Integer, 'Lines of script for command throughput, 0 to skip') { |n| options[:lines] = n }
+end.parse!
+
+@testdir = options[:testdir]
+@runs    = options[:runs]
+@mapdir  = options[:mapdir]
+@levels  = options[:levels]
+@lines   = options[:lines]
+FileUtils.mkdir_p @testdir
+
+def heading (s)
+  puts "\n#{s}\n#{'-' * s.length}\n"
+end
+
+# Run block @runs times and report average time per run
+def bench (comment, count = nil)
+  t = Benchmark.realtime { @runs.times { yield } } / @runs
+  if count
+    puts "  %-40s %10.2f ms  %12.0f %s/s" % [comment, t * 1000, count[1] / t, count[0]]
+  else
+    puts "  %-40s %10.2f ms" % [comment, t * 1000]
+  end
+  t
+end
+
+vym_mgr=VymManager.new
+
+vym=vym_mgr.find(instance_name)
+if !vym
+  puts "Couldn't find instance name \"#{instance_name}\", please start one:"
+  puts "vym -l -t -n \"#{instance_name}\" test/default.vym"
+  exit
+end
+
+#######################
+def bench_save (vym)
+  heading "Save:"
+  xmlpath = "#{@testdir}/bench-save.xml"
+  vym.exportXML(@testdir, xmlpath)
+  size = File.size(xmlpath)
+  bench("exportXML (#{size} bytes)", ["bytes", size]) { vym.exportXML(@testdir, xmlpath) }
+
+  vym.select "mc:0"
+  bench("copy mapcenter", ["bytes", size]) { vym.copy }
+end
+
+#######################
+def bench_attributes (vym)
+  heading "XML attributes (all loaded maps):"
+  (1..vym.modelCount).each do |n|
+    m = vym.model(n)
+    xmlpath = "#{@testdir}/bench-attr-#{n}.xml"
+    m.execute("exportXML ('#{@testdir}','#{xmlpath}')")
+    attributes = File.read(xmlpath).scan(/ [A-Za-z]+="/).length
+    bench("model #{n}: #{attributes} attributes", ["attr", attributes]) do
+      m.execute("exportXML ('#{@testdir}','#{xmlpath}')")
+    end
+  end
+end
+
+#######################
+def bench_load (vym)
+  return if !@mapdir
+  heading "Load (#{@mapdir}):"
+  maps = Dir.glob("#{File.expand_path(@mapdir)}/*.vym").sort
+  total = 0
+  maps.each do |fn|
+    vym.select "mc:0"
+    t = Benchmark.realtime { vym.addMapInsert(fn) }
+    vym.undo
+    puts "  %-40s %10.2f ms" % [File.basename(fn), t * 1000]
+    total += t
+  end
+  puts "  %-40s %10.2f ms" % ["#{maps.length} maps total", total * 1000]
+end
+
+#######################
+# Synthetic map with 10 children per branch, 5 levels are 111110 branches
+def write_branches (f, fanout, levels, prefix)
+  return 0 if levels == 0
+  n = 0
+  fanout.times do |i|
+    f.puts "<branch><heading>#{prefix}#{i}</heading>"
+    n += 1 + write_branches(f, fanout, levels - 1, "#{prefix}#{i}.")
+    f.puts "</branch>"
+  end
+  n
+end
+
+# Returns path of synthetic map and number of branches
+def write_synthetic (levels)
+  path = "#{@testdir}/bench-synthetic-#{levels}.xml"
+  count = 0
+  File.open(path, "w") do |f|
+    f.puts '<?xml version="1.0" encoding="utf-8"?>'
+    f.puts '<vymmap version="2.5.0"><mapcenter><heading>Synthetic</heading>'
+    count = write_branches(f, 10, levels, "")
+    f.puts '</mapcenter></vymmap>'
+  end
+  [path, count]
+end
+
+def bench_tree_walk (vym)
+  return if @levels == 0
+  path, count = write_synthetic(@levels)
+
+  heading "Tree walk (synthetic map with #{count} branches):"
+  vym.select "mc:0"
+  t = Benchmark.realtime { vym.addMapInsert(path) }
+  puts "  %-40s %10.2f ms" % ["addMapInsert", t * 1000]
+
+  ascii = "#{@testdir}/bench-synthetic.txt"
+  bench("exportASCII", ["branches", count]) { vym.exportASCII(ascii, false) }
+  bench("exportXML", ["branches", count]) { vym.exportXML(@testdir, "#{@testdir}/bench-synthetic-out.xml") }
+
+  vym.select "mc:0"
+  (@levels + 1).times { vym.selectLastBranch }
+  deep = vym.getSelectString
+  bench("select + getSelectString (#{deep})", ["calls", 1]) { vym.select deep; vym.getSelectString }
+
+  vym.undo
+end
+
+#######################
+# Editing a single leaf should not depend on the size of the map
+def bench_relayout (vym)
+  return if @levels == 0
+  heading "Relayout after editing one heading:"
+  (1..@levels).each do |levels|
+    path, count = write_synthetic(levels)
+    vym.select "mc:0"
+    vym.addMapInsert(path)
+    vym.select "mc:0"
+    (levels + 1).times { vym.selectLastBranch }
+    n = 0
+    bench("setHeading, map with #{count} branches", ["edits", 1]) do
+      n += 1
+      vym.setHeading "Edited #{n}"
+    end
+    (@runs + 1).times { vym.undo }
+  end
+end
+
+#######################
+# Repainting a zoomed out map should not cost more than the zoomed in one
+def bench_zoom (vym)
+  heading "Repaint at zoom levels:"
+  if @levels > 0
+    path, count = write_synthetic(@levels)
+    vym.select "mc:0"
+    vym.addMapInsert(path)
+  end
+  [1.0, 0.5, 0.25, 0.1].each do |z|
+    vym.setMapZoom z
+    sleep 2.5   # wait for zoom animation
+    t = 0
+    @runs.times { t += vym.getFrameTime.to_f }
+    puts "  %-40s %10.2f ms" % ["getFrameTime, zoom #{z}", t / @runs]
+  end
+  vym.setMapZoom 1.0
+  vym.undo if @levels > 0
+end
+
+#######################
+# Parsing and dispatching commands, which do hardly anything themselves
+def bench_script (vym)
+  return if @lines == 0
+  heading "Script throughput:"
+  vym.select "mc:0"
+  # Every line is different, so nothing can be taken from parser caches.
+  # A batch keeps history out of the measurement
+  lines = Array.new(@lines) { |i| "setMapComment ('bench #{i}');" }
+  script = (["beginBatch ();"] + lines + ["commitBatch ();"]).join("\n")
+  m = vym.model(1)
+  comment = vym.getMapComment
+  t = Benchmark.realtime { m.execute(script) }
+  puts "  %-40s %10.2f ms  %12.0f %s/s" % ["execute #{@lines} distinct lines", t * 1000, @lines / t, "lines"]
+  t = Benchmark.realtime { m.execute(script) }
+  puts "  %-40s %10.2f ms  %12.0f %s/s" % ["execute same script again", t * 1000, @lines / t, "lines"]
+  vym.undo
+  vym.undo
+  vym.setMapComment comment if vym.getMapComment != comment
+end
+
+#######################
+bench_save(vym)
+bench_attributes(vym)
+bench_load(vym)
+bench_tree_walk(vym)
+bench_relayout(vym)
+bench_zoom(vym)
+bench_script(vym)
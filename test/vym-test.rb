@@ -382,6 +382,30 @@ def test_moving_parts (vym)
   # FIXME-2 still has wrong position, check position
   vym.select @main_b
   vym.moveRel 100,100
+
+  init_map
+  m = vym.model(1)
+  layout = lambda do
+    # Start with overlapping main branches
+    vym.select @main_a
+    vym.move 0,0
+    vym.select @main_b
+    vym.move 10,10
+    n = vym.autoLayout(1000)
+    sleep 2	# wait for animation
+    pos = [@main_a, @main_b].map do |s| 
+      vym.select s
+      item = m.exportSubtree("")[0]
+      [item["x"], item["y"]]
+    end
+    [n, pos]
+  end
+  n1, pos1 = layout.call
+  n2, pos2 = layout.call
+  expect "autoLayout resolves all collisions", n1, 0
+  expect "autoLayout gives same positions for same map", pos2, pos1
+  err = vym.autoLayout -1
+  expect_error "autoLayout with negative time budget fails", err
 end
 
 #######################
@@ -535,10 +559,12 @@ def test_copy_paste (vym)
   vym.redo
   vym.select s
   expect "redo paste: check heading", vym.getHeadingPlainText, "Main A"
+  expect "redo paste: item index consistent", vym.checkItemIndex, true
   
   vym.cut
   vym.select @main_a
   expect "cut: branchCount of #{@main_a}", vym.branchCount, n
+  expect "cut: item index consistent", vym.checkItemIndex, true
   vym.paste
   vym.selectLastBranch
   s=vym.getSelectString
@@ -595,6 +621,135 @@ def test_history (vym)
   vym.selectLastBranch
   expect "Paste from the past", vym.getHeadingPlainText, "A"
   vym.delete
+  expect "Item index consistent after history", vym.checkItemIndex, true
+end  
+
+#######################
+def test_batch (vym)
+  heading "Batch mode"
+  init_map
+  vym.select @main_a
+  vym.beginBatch
+  vym.setHeadingPlainText "A"
+  vym.addBranch
+  vym.addBranch
+  vym.select @main_a
+  vym.setHeadingPlainText "B"
+  vym.commitBatch
+  expect "commitBatch: check heading", vym.getHeadingPlainText, "B"
+  expect "commitBatch: branchCount", vym.branchCount, 5
+  vym.undo
+  vym.select @main_a
+  expect "Undo batch in one step: check heading", vym.getHeadingPlainText, "Main A"
+  expect "Undo batch in one step: branchCount", vym.branchCount, 3
+  vym.redo
+  vym.select @main_a
+  expect "Redo batch: check heading", vym.getHeadingPlainText, "B"
+  expect "Redo batch: branchCount", vym.branchCount, 5
+  vym.undo
+  vym.select @main_a
+  expect "Undo batch again: check heading", vym.getHeadingPlainText, "Main A"
+  err = vym.commitBatch
+  expect_error "commitBatch without beginBatch fails", err
+
+  m = vym.model(1)
+  ids = m.exportSubtree("")[0]["children"].map { |c| c["id"] }
+  vym.setMapTitle "Before batch"
+  m.execute "beginBatch ();setMapTitle ('In batch');select ('#{@main_a}');addBranch ();commitBatch ()"
+  vym.undo
+  expect "Undo batch keeps UUIDs", m.getItems(ids)[0][1]["heading"], "branch b"
+  expect "Undo batch restores map title", vym.getMapTitle, "Before batch"
+
+  m.execute "beginBatch ();select ('#{@main_a}');setHeadingPlainText ('C');relinkTo ('#{@main_a}',0,0,0)"
+  err = vym.commitBatch
+  expect_error "Failed script closes its batch", err
+  vym.select @main_a
+  expect "Failed script restores map", vym.getHeadingPlainText, "Main A"
+
+  vym.beginBatch
+  vym.setHeadingPlainText "D"
+  err = vym.undo
+  expect_error "Undo within batch fails", err
+  vym.commitBatch
+  vym.undo
+  vym.select @main_a
+  expect "Undo after batch undoes whole batch", vym.getHeadingPlainText, "Main A"
+  expect "Item index consistent after batch", vym.checkItemIndex, true
+end  
+
+#######################
+def test_bulk_api (vym)
+  heading "Bulk access via DBUS"
+  init_map
+  m = vym.model(1)
+  vym.select @main_a
+  tree = m.exportSubtree("")[0]
+  expect "exportSubtree: heading", tree["heading"], "Main A"
+  expect "exportSubtree: number of children", tree["children"].length, 3
+  expect "exportSubtree: heading of child", tree["children"][0]["heading"], "branch a"
+
+  ids = tree["children"].map { |c| c["id"] }
+  items = m.getItems(ids)[0]
+  expect "getItems: number of items", items.length, 3
+  expect "getItems: heading", items[1]["heading"], "branch b"
+
+  m.executeList(["select ('#{@main_a}')", "setHeadingPlainText ('X')", "addBranch ()"])
+  vym.select @main_a
+  expect "executeList: check heading", vym.getHeadingPlainText, "X"
+  expect "executeList: branchCount", vym.branchCount, 4
+  vym.undo
+  vym.select @main_a
+  expect "Undo executeList in one step", vym.getHeadingPlainText, "Main A"
+
+  m.executeList(["select ('#{@main_a}')", "setHeadingPlainText ('Y')", "relinkTo ('#{@main_a}',0,0,0)"])
+  expect "executeList with error sets errorLevel", m.errorLevel[0] > 0, true
+  vym.select @main_a
+  expect "executeList with error restores map", vym.getHeadingPlainText, "Main A"
+  expect "executeList with error keeps UUIDs", m.getItems(ids)[0][1]["heading"], "branch b"
+
+  vym.setHeadingPlainText "Z"
+  m.executeList(["select ('#{@main_a}')", "getHeadingPlainText ()"])
+  vym.undo
+  vym.select @main_a
+  expect "executeList without changes adds no history step", vym.getHeadingPlainText, "Main A"
+  expect "Item index consistent after executeList", vym.checkItemIndex, true
+end  
+
+#######################
+def test_network (vym)
+  heading "Network"
+  if vym.modelCount < 2
+    puts "Skipped: needs a second map as client"
+    return
+  end
+  init_map
+  server = vym.model(1)
+  client = vym.model(2)
+  port = 54399
+  server.execute "newServer (#{port})"
+  server.execute "select ('#{@main_a}')"
+  server.execute "setHeadingPlainText ('Net A')"
+
+  client.execute "connectToServer ('localhost',#{port})"
+  sleep 1
+  client.execute "select ('#{@main_a}')"
+  expect "Snapshot for new client: heading", client.execute("getHeadingPlainText ()")[0], "Net A"
+
+  server.execute "select ('#{@main_a}');setHeadingPlainText ('Net B');addBranch ();addBranch ()"
+  sleep 1
+  client.execute "select ('#{@main_a}')"
+  expect "Delta: heading", client.execute("getHeadingPlainText ()")[0], "Net B"
+  expect "Delta: branchCount", client.execute("branchCount ()")[0], 5
+
+  server.execute "beginBatch ();select ('#{@main_a}');setHeadingPlainText ('Net C');commitBatch ()"
+  server.execute "undo ()"
+  sleep 1
+  client.execute "select ('#{@main_a}')"
+  expect "Undo of batch: heading", client.execute("getHeadingPlainText ()")[0], "Net B"
+  expect "Undo of batch: branchCount", client.execute("branchCount ()")[0], 5
+
+  server.execute "newServer (#{port})"
+  expect "newServer on connected map fails", server.errorLevel[0] > 0, true
 end  
 
 #######################
@@ -787,11 +942,14 @@ test_delete_parts(vym)
 test_copy_paste(vym)
 test_references(vym)
 test_history(vym)
+test_batch(vym)
+test_bulk_api(vym)
 test_xlinks(vym)
 test_tasks(vym)
 test_notes(vym)
 test_headings(vym)
 test_bugfixes(vym)
+test_network(vym)
 summary
 
 =begin
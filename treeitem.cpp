@@ -25,6 +25,7 @@ TreeItem::TreeItem()
     itemData.clear();
     rootItem=this;
     parentItem=NULL;
+    cachedDepth=-1;
 }
 
 TreeItem::TreeItem(const QList<QVariant> &data, TreeItem *parent)
@@ -35,8 +36,12 @@ TreeItem::TreeItem(const QList<QVariant> &data, TreeItem *parent)
     itemData = data;
     
     rootItem=this;
+    cachedDepth=-1;
     if (parentItem )
+    {
 	rootItem=parentItem->rootItem;
+	cachedDepth=parentItem->cachedDepth + 1;
+    }
 }
 
 TreeItem::~TreeItem()
@@ -48,6 +53,7 @@ TreeItem::~TreeItem()
         ti = childItems.takeFirst();
         delete ti;
     }
+    if (model) model->unregisterItem (this);
 }
 
 
@@ -74,6 +80,8 @@ void TreeItem::init()
 
     target = false;
 
+    cachedRow = -1;
+
     heading.clear();
     note.setText("");
 
@@ -88,7 +96,10 @@ void TreeItem::init()
 
 void TreeItem::setModel (VymModel *m)
 {
+    if (model==m) return;
+    if (model) model->unregisterItem (this);
     model = m;
+    if (model) model->registerItem (this);
 }
 
 VymModel* TreeItem::getModel ()
@@ -114,11 +125,13 @@ void TreeItem::appendChild(TreeItem *item)
     item->parentItem=this;
     item->rootItem=rootItem;
     item->setModel (model);
+    item->setDepth (cachedDepth + 1);
 
     if (item->type == Attribute)
     {
 	// attribute are on top of list
 	childItems.insert (attributeCounter,item);
+	updateChildRows (attributeCounter, item);
 	attributeCounter++;
 	xlinkOffset++;
 	imageOffset++;
@@ -128,6 +141,7 @@ void TreeItem::appendChild(TreeItem *item)
     if (item->type == XLink)
     {
 	childItems.insert (xlinkCounter+xlinkOffset,item);
+	updateChildRows (xlinkCounter+xlinkOffset, item);
 	xlinkCounter++;
 	imageOffset++;
 	branchOffset++;
@@ -136,6 +150,7 @@ void TreeItem::appendChild(TreeItem *item)
     if (item->type == Image)
     {
 	childItems.insert (imageCounter+imageOffset,item);
+	updateChildRows (imageCounter+imageOffset, item);
 	imageCounter++;
 	branchOffset++;
     }
@@ -144,6 +159,7 @@ void TreeItem::appendChild(TreeItem *item)
     {
 	// branches are on bottom of list
 	childItems.append(item);
+	updateChildRows (childItems.count()-1, item);
 	branchCounter++;
 
 	// Set correct type	
@@ -181,7 +197,10 @@ void TreeItem::removeChild(int row)
 	if (childItems.at(row)->isBranchLikeType())
 	    branchCounter--;
 
-	childItems.removeAt (row);
+	TreeItem *ti=childItems.takeAt (row);
+	ti->cachedRow=-1;
+	ti->selectSegment.clear();
+	updateChildRows (row, ti);
     }
 }
 
@@ -198,7 +217,7 @@ int TreeItem::childCount() const
 int TreeItem::childNumber() const
 {
     if (parentItem)
-        return parentItem->childItems.indexOf(const_cast<TreeItem*>(this));
+        return cachedRow;
 
     return 0;
 }
@@ -231,7 +250,7 @@ int TreeItem::attributeCount() const
 int TreeItem::row() const
 {
     if (parentItem)
-        return parentItem->childItems.indexOf(const_cast<TreeItem*>(this));
+        return cachedRow;
 
     qDebug() << "TI::row() pI=NULL this="<<this<<"  ***************";
     return 0;
@@ -241,14 +260,7 @@ int TreeItem::depth()
 {
     // Rootitem d=-1
     // MapCenter d=0
-    int d=-2;
-    TreeItem *ti=this;
-    while (ti!=NULL)
-    {
-	ti=ti->parent();
-	d++;
-    }
-    return d;
+    return cachedDepth;
 }
 
 TreeItem *TreeItem::parent()
@@ -267,7 +279,7 @@ bool TreeItem::isChildOf (TreeItem *ti)
 
 int TreeItem::childNum()
 {
-    return parentItem->childItems.indexOf (this);
+    return cachedRow;
 }
 
 int TreeItem::num()
@@ -278,20 +290,68 @@ int TreeItem::num()
 
 int TreeItem::num (TreeItem *item)
 {
-    if (!item) return -1;
-    if (!childItems.contains(item)) return -1;
+    if (!item || item->parentItem!=this || item->cachedRow<0) return -1;
     switch (item->getType())
     {
-	case MapCenter: return childItems.indexOf (item) - branchOffset;
-	case Branch: return childItems.indexOf (item) - branchOffset;
-	case Image: return childItems.indexOf (item) - imageOffset;
-	case Attribute: return childItems.indexOf (item) - attributeOffset;
-	case XLink: return childItems.indexOf (item) - xlinkOffset;
+	case MapCenter: return item->cachedRow - branchOffset;
+	case Branch: return item->cachedRow - branchOffset;
+	case Image: return item->cachedRow - imageOffset;
+	case Attribute: return item->cachedRow - attributeOffset;
+	case XLink: return item->cachedRow - xlinkOffset;
 	default: return -1;
     }
 }
+const QString& TreeItem::getSelectSegment()
+{
+    if (selectSegment.isEmpty() )
+    {
+	switch (getType())
+	{
+	    case MapCenter: selectSegment="mc:"; break;
+	    case Branch: selectSegment="bo:";break;
+	    case Image: selectSegment="fi:";break;
+	    case Attribute: selectSegment="ai:";break;
+	    case XLink: selectSegment="xl:";break;
+	    default:
+		selectSegment="unknown type in VymModel::getSelectString()";
+		break;
+	}
+	selectSegment+=QString::number (num() );
+    }
+    return selectSegment;
+}
+
+void TreeItem::updateChildRows (int from, TreeItem *changed)
+{
+    // Only siblings of the same kind are numbered together in select strings
+    bool branchLike=changed->isBranchLikeType();
+    for (int i=from; i<childItems.count(); i++)
+    {
+	TreeItem *ti=childItems.at(i);
+	ti->cachedRow=i;
+	if (ti->type==changed->type || (branchLike && ti->isBranchLikeType()) )
+	    ti->selectSegment.clear();
+    }
+
+    // Added or removed branches change size and layout of siblings
+    if (branchLike && isBranchLikeType() )
+    {
+	LinkableMapObj* lmo=((MapItem*)this)->getLMO();
+	if (lmo) lmo->requestReposition();
+    }
+}
+
+void TreeItem::setDepth (int d)
+{
+    if (cachedDepth==d) return;
+    cachedDepth=d;
+    for (int i=0; i<childItems.count(); i++)
+	childItems.at(i)->setDepth (d + 1);
+}
+
 void TreeItem::setType(const Type t)
 {
+    selectSegment.clear();
     type=t;
     itemData[1]=getTypeName();
 }
@@ -332,6 +392,7 @@ void TreeItem::setHeading (const VymText &vt)
 {
     heading = vt;
     itemData[0]= heading.getTextASCII();  // used in TreeEditor
+    if (model) model->searchTextChanged (this);
 }
 
 void TreeItem::setHeadingPlainText (const QString &s)
@@ -417,6 +478,7 @@ QColor TreeItem::getBackgroundColor()
 void TreeItem::setURL (const QString &u)
 {
     url=u;
+    if (model) model->searchTextChanged (this);
     if (!url.isEmpty())
     {
 	if (url.contains ("bugzilla.novell.com"))
@@ -500,6 +562,7 @@ void TreeItem::clearNote()
 {
     note.clear();
     systemFlags.deactivate ("system-note");
+    if (model) model->searchTextChanged (this);
 }
 
 void TreeItem::setNote(const VymText &vt)
@@ -509,6 +572,7 @@ void TreeItem::setNote(const VymText &vt)
 	systemFlags.activate ("system-note");
     if (note.isEmpty() && systemFlags.isActive ("system-note"))
 	systemFlags.deactivate ("system-note");
+    if (model) model->searchTextChanged (this);
 }
 
 void TreeItem::setNote(const VymNote &vn)
@@ -518,6 +582,7 @@ void TreeItem::setNote(const VymNote &vn)
     systemFlags.activate ("system-note");
     if (note.isEmpty() && systemFlags.isActive ("system-note"))
     systemFlags.deactivate ("system-note");
+    if (model) model->searchTextChanged (this);
 }
 
 bool TreeItem::hasEmptyNote()
@@ -635,7 +700,9 @@ uint TreeItem::getID()
 
 void TreeItem::setUuid(const QString &id)
 {
+    if (model) model->unregisterItem (this);
     uuid=QUuid(id);
+    if (model) model->registerItem (this);
 }
 
 QUuid TreeItem::getUuid()
@@ -772,7 +839,7 @@ void TreeItem::setHideTmp (HideTmpMode mode)
     if (type==Image || type==Branch || type==MapCenter)
 //	((ImageItem*)this)->updateVisibility();
     {
-	//LinkableMapObj* lmo=((MapItem*)this)->getLMO();
+	bool wasHidden=hidden;
 
 	if (mode==HideExport && (hideExport || hasHiddenExportParent() ) ) // FIXME-4  try to avoid calling hasScrolledParent repeatedly
 
@@ -781,6 +848,11 @@ void TreeItem::setHideTmp (HideTmpMode mode)
 	else
 	    // Do not hide, but still take care of scrolled status
 	    hidden=false;
+	if (hidden!=wasHidden)
+	{
+	    LinkableMapObj* lmo=((MapItem*)this)->getLMO();
+	    if (lmo) lmo->requestReposition();
+	}
 	updateVisibility();
 	// And take care of my children
 	for (int i=0; i<branchCount(); ++i)
@@ -66,7 +66,14 @@ public:
     virtual int num();			//! Return number of item by type
     virtual int num (TreeItem *item);	//! Return number of item by type
 
+    const QString& getSelectSegment();	//! Own part of select string, e.g. "bo:3". Cached.
 protected:
+    void updateChildRows (int from, TreeItem *changed);	//! Children from row on have moved
+    void setDepth (int d);		//! Set cached depth of item and its children
+    int cachedDepth;
+    int cachedRow;
+    QString selectSegment;
+
     Type type;
 public:	
     virtual void setType (const Type t);
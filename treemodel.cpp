@@ -307,3 +307,19 @@ Link* TreeModel::getXLinkNum (const int &n)
 
 }
 
+
+void TreeModel::registerItem (TreeItem *ti)
+{
+    itemIndexID.insert (ti->getID(), ti);
+    QUuid uuid=ti->getUuid();
+    if (!itemIndexUuid.contains (uuid, ti))
+	itemIndexUuid.insert (uuid, ti);
+}
+
+void TreeModel::unregisterItem (TreeItem *ti)
+{
+    QHash <uint,TreeItem*>::iterator it=itemIndexID.find (ti->getID() );
+    if (it!=itemIndexID.end() && it.value()==ti)
+	itemIndexID.erase (it);
+    itemIndexUuid.remove (ti->getUuid(), ti);
+}
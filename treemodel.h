@@ -2,7 +2,9 @@
 #define TREEMODEL_H
 
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QModelIndex>
+#include <QUuid>
 #include <QVariant>
 
 
@@ -30,6 +32,7 @@ public:
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
     int columnCount(const QModelIndex &parent = QModelIndex()) const;
 
+    //! Step through branches, keeping state in current and previous. See also BranchIterator.
     void nextBranch (BranchItem* &current, BranchItem* &previous, bool deepLevelsFirst=false, BranchItem* start=NULL);
 
     bool removeRows ( int row, int count, 
@@ -41,9 +44,15 @@ public:
     virtual int xlinkCount();
     virtual Link* getXLinkNum (const int &n); 
 
+    virtual void registerItem (TreeItem *ti);	//!< Add item to lookup index by ID and uuid
+    virtual void unregisterItem (TreeItem *ti);	//!< Remove item from lookup index
+
 protected:
     BranchItem *rootItem;
 
+    QHash <uint,TreeItem*> itemIndexID;		//!< Lookup index for findID
+    QMultiHash <QUuid,TreeItem*> itemIndexUuid;	//!< Lookup index for findUuid, uuids may be duplicated by paste
+
     QList <Link*> xlinks;
     QList <uint> deleteLaterIDs;
 
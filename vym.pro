@@ -17,6 +17,10 @@ QT += widgets
 
 RESOURCES = vym.qrc
 
+# In-process zip support for .vym files
+unix: LIBS += -lz
+win32: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+
 unix:!macx:isEmpty(NO_DBUS) {
     message("Compiling with DBUS")
     DEFINES += VYM_DBUS
@@ -72,6 +76,7 @@ HEADERS	+= \
 #   attributedialog.h \
 #   attributewidget.h \
     branchitem.h \
+    branchiterator.h \
     branchobj.h \
     branchpropeditor.h\
     bugagent.h \
@@ -88,6 +93,7 @@ HEADERS	+= \
     findresultwidget.h \
     findresultitem.h \
     findresultmodel.h \
+    findworker.h \
     flag.h \
     flagobj.h \
     flagrowobj.h \
@@ -119,6 +125,7 @@ HEADERS	+= \
     ornamentedobj.h \
     parser.h \
     scripteditor.h\
+    searchindex.h \
     settings.h \
     shortcuts.h\
     showtextdialog.h\
@@ -126,6 +133,7 @@ HEADERS	+= \
     slideeditor.h\
     slideitem.h\
     slidemodel.h\
+    spatialindex.h \
     task.h\
     taskeditor.h\
     taskmodel.h\
@@ -150,7 +158,8 @@ HEADERS	+= \
     xml-vym.h \
     xml-freemind.h \
     xmlobj.h\
-    xsltproc.h 
+    xsltproc.h \
+    zipfile.h
 
 SOURCES	+= \
     aboutdialog.cpp \
@@ -163,6 +172,7 @@ SOURCES	+= \
 #   attributedialog.cpp \
 #   attributewidget.cpp \
     branchitem.cpp \
+    branchiterator.cpp \
     branchobj.cpp \
     branchpropeditor.cpp \
     bugagent.cpp \
@@ -179,6 +189,7 @@ SOURCES	+= \
     findresultwidget.cpp \
     findresultitem.cpp \
     findresultmodel.cpp \
+    findworker.cpp \
     flag.cpp \
     flagobj.cpp \
     flagrow.cpp \
@@ -211,6 +222,7 @@ SOURCES	+= \
     ornamentedobj.cpp \
     parser.cpp \
     scripteditor.cpp \
+    searchindex.cpp \
     settings.cpp \
     shortcuts.cpp\
     showtextdialog.cpp \
@@ -218,6 +230,7 @@ SOURCES	+= \
     slideeditor.cpp \
     slideitem.cpp \
     slidemodel.cpp \
+    spatialindex.cpp \
     task.cpp \
     taskeditor.cpp \
     taskmodel.cpp \
@@ -242,7 +255,8 @@ SOURCES	+= \
     xml-vym.cpp \
     xml-freemind.cpp \
     xmlobj.cpp \
-    xsltproc.cpp 
+    xsltproc.cpp \
+    zipfile.cpp 
 
 FORMS = \
     attributewidget.ui \
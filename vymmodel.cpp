@@ -1,4 +1,5 @@
 #include <QApplication>
+#include <QBuffer>
 #include <QSvgGenerator>
 
 #if defined(VYM_DBUS)
@@ -21,13 +22,16 @@
 #include "attributeitem.h"
 #include "treeitem.h"
 #include "branchitem.h"
+#include "branchiterator.h"
 #include "bugagent.h"
+#include "command.h"
 #include "downloadagent.h"
 #include "editxlinkdialog.h"
 #include "exports.h"
 #include "exporthtmldialog.h"
 #include "file.h"
 #include "findresultmodel.h"
+#include "findworker.h"
 #include "lockedfiledialog.h"
 #include "mainwindow.h"
 #include "misc.h"
@@ -35,6 +39,8 @@
 #include "options.h"
 #include "parser.h"
 #include "vymprocess.h"
+#include "searchindex.h"
+#include "spatialindex.h"
 #include "scripteditor.h" 
 #include "slideitem.h"
 #include "slidemodel.h"
@@ -46,6 +52,7 @@
 #include "xml-freemind.h"
 #include "xmlobj.h"
 #include "xml-vym.h"
+#include "zipfile.h"
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -104,6 +111,19 @@ VymModel::~VymModel()
     fileChangedTimer->stop();
     stopAllAnimation();
 
+    // Background searches still might be running
+    foreach (FindWorker *fw, findChildren <FindWorker*> () )
+    {
+	fw->cancel();
+	fw->wait();
+    }
+    if (findResultModel && findResultModel->getOwner()==this)
+	findResultModel->setOwner (NULL);
+    delete searchIndex;
+    searchIndex=NULL;
+    delete spatialIndex;
+    spatialIndex=NULL;
+
     //qApp->processEvents();	// Update view (scene()->update() is not enough)
     //qDebug() << "Destr VymModel end   this="<<this;
 }   
@@ -121,6 +141,7 @@ void VymModel::init ()
 {
     // No MapEditor yet
     mapEditor       = NULL;
+    spatialIndex    = new SpatialIndex;
 
     // Use default author
     author = settings.value("/user/name", tr("unknown user","default name for map author in settings")).toString();
@@ -150,6 +171,14 @@ void VymModel::init ()
     mapName         = fileName;
     blockReposition = false;
     blockSaveState  = false;
+    batchLevel      = 0;
+    batchCount      = 0;
+    blockSendData   = false;
+    restoringMap    = false;
+
+    itemNotifyTimer = new QTimer (this);
+    itemNotifyTimer->setSingleShot (true);
+    connect(itemNotifyTimer, SIGNAL(timeout()), this, SLOT(emitItemNotifications()));
 
     autosaveTimer   = new QTimer (this);
     connect(autosaveTimer, SIGNAL(timeout()), this, SLOT(autosave()));
@@ -159,13 +188,18 @@ void VymModel::init ()
     connect(fileChangedTimer, SIGNAL(timeout()), this, SLOT(fileChanged()));
 
     // find routine
+    searchIndex = new SearchIndex (this);
+    findWorker = NULL;
+    findResultModel = NULL;
     findReset();
 
     // animations   // FIXME-4 switch to new animation system 
     animationUse    = settings.value ("/animation/use",false).toBool();    // FIXME-4 add options to control _what_ is animated
     animationTicks  = settings.value("/animation/ticks",20).toInt();
-    animationInterval=settings.value("/animation/interval",5).toInt();
-    animObjList.clear();    
+    animationInterval=qMax (settings.value("/animation/interval",5).toInt(), 1);
+    animationFrameRate=qBound (1, settings.value("/animation/fps",50).toInt(), 200);
+    animationTicksDone=0;
+    animObjects.clear();    
     animationTimer  = new QTimer (this);
     connect(animationTimer, SIGNAL(timeout()), this, SLOT(animate()));
 
@@ -199,6 +233,14 @@ void VymModel::init ()
 
     // Network
     netstate        = Offline;
+    tcpServer       = NULL;
+    clientSocket    = NULL;
+    connectWaiting  = false;
+    sendCounter     = 0;
+    receiveCounter  = 0;
+    sendTimer       = new QTimer (this);
+    sendTimer->setSingleShot (true);
+    connect(sendTimer, SIGNAL(timeout()), this, SLOT(sendQueued()));
 
 #if defined(VYM_DBUS)
      // Announce myself on DBUS
@@ -222,6 +264,11 @@ MapEditor* VymModel::getMapEditor()
     return mapEditor;
 }
 
+SpatialIndex* VymModel::getSpatialIndex() 
+{
+    return spatialIndex;
+}
+
 bool VymModel::isRepositionBlocked()
 {
     return blockReposition;
@@ -236,6 +283,35 @@ void VymModel::updateActions()
 
 
 QString VymModel::saveToDir(const QString &tmpdir, const QString &prefix, bool writeflags, const QPointF &offset, TreeItem *saveSel)
+{
+    // Convenience wrapper for callers which really need the XML as string
+    QBuffer buffer;
+    buffer.open (QIODevice::WriteOnly);
+    {
+        XMLWriter xw (&buffer);
+        saveToDir (xw, tmpdir, prefix, writeflags, offset, saveSel);
+    }
+    return QString::fromUtf8 (buffer.data() );
+}
+
+bool VymModel::saveToDisk(const QString &fname, const QString &tmpdir, const QString &prefix, bool writeflags, const QPointF &offset, TreeItem *saveSel)
+{
+    QFile file(fname);
+    // Write as binary (default), QFile::Text would convert linebreaks
+    if (!file.open(QFile::WriteOnly  )) {
+        qWarning()<<QString("VymModel::saveToDisk: Cannot write file %1:\n%2.")
+                    .arg(fname)
+                    .arg(file.errorString());
+        return false;
+    }
+
+    XMLWriter xw (&file);
+    saveToDir (xw, tmpdir, prefix, writeflags, offset, saveSel);
+    xw.flush();
+    return xw.isOk() && file.error() == QFile::NoError;
+}
+
+void VymModel::saveToDir(XMLWriter &xw, const QString &tmpdir, const QString &prefix, bool writeflags, const QPointF &offset, TreeItem *saveSel)
 {
     // tmpdir	    temporary directory to which data will be written
     // prefix	    mapname, which will be appended to images etc.
@@ -264,7 +340,7 @@ QString VymModel::saveToDir(const QString &tmpdir, const QString &prefix, bool w
 	    break;
     }	
 
-    QString s="<?xml version=\"1.0\" encoding=\"utf-8\"?><!DOCTYPE vymmap>\n";
+    xw << "<?xml version=\"1.0\" encoding=\"utf-8\"?><!DOCTYPE vymmap>\n";
     QString colhint="";
     if (linkcolorhint==LinkableMapObj::HeadingColor) 
 	colhint=xml.attribut("linkColorHint","HeadingColor");
@@ -289,7 +365,7 @@ QString VymModel::saveToDir(const QString &tmpdir, const QString &prefix, bool w
 		  xml.attribut("mapZoomFactor", QString().setNum(mapEditor->getZoomFactorTarget()) ) +
 		  xml.attribut("mapRotationAngle", QString().setNum(mapEditor->getAngleTarget()) ) +
 		  colhint; 
-    s+=xml.beginElement("vymmap",mapAttr); 
+    xw << xml.beginElement("vymmap",mapAttr); 
     xml.incIndent();
 
     // Find the used flags while traversing the tree	
@@ -303,14 +379,14 @@ QString VymModel::saveToDir(const QString &tmpdir, const QString &prefix, bool w
     if (!saveSel)
     {
 	// Save all mapcenters as complete map, if saveSel not set
-	s+=saveTreeToDir(tmpdir,prefix,offset,tmpLinks);
+	saveTreeToDir(xw,tmpdir,prefix,offset,tmpLinks);
 
 	// Save local settings
-	s+=settings.getDataXML (destPath);
+	xw << settings.getDataXML (destPath);
 
 	// Save selection
 	if (getSelectedItem() && !saveSel ) 
-	    s+=xml.valueElement("select",getSelectString());
+	    xw << xml.valueElement("select",getSelectString());
 
     } else
     {
@@ -318,15 +394,15 @@ QString VymModel::saveToDir(const QString &tmpdir, const QString &prefix, bool w
 	{
 	    case TreeItem::Branch:
 		// Save Subtree
-		s+=((BranchItem*)saveSel)->saveToDir(tmpdir,prefix,offset,tmpLinks);
+		((BranchItem*)saveSel)->saveToDir(xw,tmpdir,prefix,offset,tmpLinks);
 		break;
 	    case TreeItem::MapCenter:
 		// Save Subtree
-		s+=((BranchItem*)saveSel)->saveToDir(tmpdir,prefix,offset,tmpLinks);
+		((BranchItem*)saveSel)->saveToDir(xw,tmpdir,prefix,offset,tmpLinks);
 		break;
 	    case TreeItem::Image:
 		// Save Image
-		s+=((ImageItem*)saveSel)->saveToDir(tmpdir,prefix);
+		xw << ((ImageItem*)saveSel)->saveToDir(tmpdir,prefix);
 		break;
 	    default: 
 		// other types shouldn't be safed directly...
@@ -336,24 +412,21 @@ QString VymModel::saveToDir(const QString &tmpdir, const QString &prefix, bool w
 
     // Save XLinks
     for (int i=0; i<tmpLinks.count();++i)
-	s+=tmpLinks.at(i)->saveToDir();
+	xw << tmpLinks.at(i)->saveToDir();
 
     // Save slides  
-    s+=slideModel->saveToDir();	
+    xw << slideModel->saveToDir();	
 
     xml.decIndent();
-    s+=xml.endElement("vymmap");
+    xw << xml.endElement("vymmap");
 
     if (writeflags) standardFlagsMaster->saveToDir (tmpdir+"/flags/","",writeflags);
-    return s;
 }
 
-QString VymModel::saveTreeToDir (const QString &tmpdir,const QString &prefix, const QPointF &offset, QList <Link*> &tmpLinks)
+void VymModel::saveTreeToDir (XMLWriter &xw, const QString &tmpdir,const QString &prefix, const QPointF &offset, QList <Link*> &tmpLinks)
 {
-    QString s;
     for (int i=0; i<rootItem->branchCount(); i++)
-	s+=rootItem->getBranchNum(i)->saveToDir (tmpdir,prefix,offset,tmpLinks);
-    return s;
+	rootItem->getBranchNum(i)->saveToDir (xw,tmpdir,prefix,offset,tmpLinks);
 }
 
 void VymModel::setFilePath(QString fpath, QString destname)
@@ -488,29 +561,30 @@ File::ErrorCode VymModel::loadMap (
     if (lmode == NewMap)
     {
 	// Reset timestamp to check for later updates of file
-	fileChangedTime = QFileInfo (destPath).lastModified();
+	if (!restoringMap)
+	    fileChangedTime = QFileInfo (destPath).lastModified();
 
 	selModel->clearSelection();
     } 
 
-    // Create temporary directory for packing
-    bool ok;
-    QString tmpZipDir = makeTmpDir (ok,"vym-pack");
-    if (!ok)
-    {
-	QMessageBox::critical( 0, tr( "Critical Load Error" ),
-	   tr("Couldn't create temporary directory before load\n"));
-	return File::Aborted; 
-    }
-
+    // Members of zipped maps are read directly from the archive
+    ZipReader *zipReader = NULL;
     if (fname.right(4) == ".xml" || fname.right(3) == ".mm")
         err = File::NoZip;
     else
     {
-        // Try to unzip file
-        err = unzipDir (tmpZipDir,fname);
+        // Try to open as zip archive
+        zipReader = new ZipReader (fname);
+        if (!zipReader->open() )
+        {
+            delete zipReader;
+            zipReader = NULL;
+            err = File::NoZip;
+        }
     }
+
     QString xmlfile;
+    QByteArray xmlData;
     if (err == File::NoZip)
     {
 	xmlfile = fname;
@@ -519,49 +593,45 @@ File::ErrorCode VymModel::loadMap (
     {
 	zipped = true;
 	
-	// Look for mapname.xml
+	// Look for map.xml or mapname.xml
 	xmlfile = fname.left(fname.lastIndexOf(".", -1, Qt::CaseSensitive));
-	xmlfile = xmlfile.section( '/', -1 );
-	QFile mfile( tmpZipDir + "/" + xmlfile + ".xml");
-	if (!mfile.exists() )
+	xmlfile = xmlfile.section( '/', -1 ) + ".xml";
+	if (!zipReader->contains (xmlfile) )
 	{
 	    // mapname.xml does not exist, well, 
 	    // maybe someone renamed the mapname.vym file...
 	    // Try to find any .xml in the toplevel 
 	    // directory of the .vym file
-	    QStringList filters;
-	    filters<<"*.xml";
-	    QStringList flist = QDir (tmpZipDir).entryList(filters);
+	    QStringList flist;
+	    foreach (QString n, zipReader->entryNames() )
+		if (!n.contains ("/") && n.endsWith (".xml") ) flist.append (n);
 	    if (flist.count() == 1) 
-	    {
 		// Only one entry, take this one
-                xmlfile = tmpZipDir + "/"+flist.first();
-        } else
-        {
-            for ( QStringList::Iterator it = flist.begin(); it != flist.end(); ++it )
-                *it=tmpZipDir + "/" + *it;
-            // FIXME-4 Multiple entries, load all (but only the first one into this ME)
-            //mainWindow->fileLoadFromTmp (flist);
-            //returnCode=1;	// Silently forget this attempt to load
-            qWarning ("MainWindow::load (fn)  multimap found...");
-        }
+                xmlfile = flist.first();
+            else
+            {
+                // FIXME-4 Multiple entries, load all (but only the first one into this ME)
+                //mainWindow->fileLoadFromTmp (flist);
+                //returnCode=1;	// Silently forget this attempt to load
+                qWarning ("MainWindow::load (fn)  multimap found...");
+            }
 
-        if (flist.isEmpty() )
-        {
-            QMessageBox::critical( 0, tr( "Critical Load Error" ),
-                                   tr("Couldn't find a map (*.xml) in .vym archive.\n"));
-            err=File::Aborted;
-        }
-	} //file doesn't exist	
-	else
-	    xmlfile=mfile.fileName();
+            if (flist.isEmpty() )
+            {
+                QMessageBox::critical( 0, tr( "Critical Load Error" ),
+                                       tr("Couldn't find a map (*.xml) in .vym archive.\n"));
+                err=File::Aborted;
+            }
+	} 
+	xmlData = zipReader->fileData (xmlfile);
     }
 
     QFile file( xmlfile);
+    QBuffer buffer (&xmlData);
 
     // I am paranoid: file should exist anyway
     // according to check in mainwindow.
-    if (!file.exists() )
+    if ( (!zipped && !file.exists() ) || (zipped && xmlData.isEmpty() ) )
     {
 	QMessageBox::critical( 0, tr( "Critical Parse Error" ),
 		   tr(QString("Couldn't open map %1").arg(file.fileName()).toUtf8()));
@@ -572,20 +642,23 @@ File::ErrorCode VymModel::loadMap (
 	blockReposition = true;
 	blockSaveState  = true;
 	mapEditor->setViewportUpdateMode (QGraphicsView::NoViewportUpdate);
-	QXmlInputSource source( &file);
+	QXmlInputSource source( zipped ? (QIODevice*) &buffer : (QIODevice*) &file);
 	QXmlSimpleReader reader;
 	reader.setContentHandler( handler );
 	reader.setErrorHandler( handler );
 	handler->setModel ( this);
 
 	// We need to set the tmpDir in order  to load files with rel. path
-	QString tmpdir;
+	// For zipped maps these are read from the archive instead
 	if (zipped)
-	    tmpdir = tmpZipDir;
-	else
-	    tmpdir = fname.left(fname.lastIndexOf("/", -1));	
-	handler->setTmpDir (tmpdir);
-	handler->setInputFile (file.fileName());
+	{
+	    handler->setZipReader (zipReader);
+	    handler->setInputData (xmlData);
+	} else
+	{
+	    handler->setTmpDir (fname.left(fname.lastIndexOf("/", -1)) );
+	    handler->setInputFile (file.fileName());
+	}
 	if (lmode == ImportReplace)
 	    handler->setLoadMode (ImportReplace, pos);
 	else	
@@ -601,7 +674,7 @@ File::ErrorCode VymModel::loadMap (
 	    reposition();   // to generate bbox sizes
 	    emitSelectionChanged();
 
-	    if (lmode == NewMap)
+	    if (lmode == NewMap && !restoringMap)
 	    {
 		mapDefault = false;
 		mapChanged = false;
@@ -627,8 +700,8 @@ File::ErrorCode VymModel::loadMap (
 	}   
     }	
 
-    // Delete tmpZipDir
-    removeDir (QDir(tmpZipDir));
+    // Close archive
+    delete zipReader;
 
     // Restore original zip state
     zipped = zipped_org;
@@ -649,6 +722,28 @@ File::ErrorCode VymModel::loadMap (
     return err;
 }
 
+bool VymModel::restoreMap (const QString &path, const QString &sel)
+{
+    // Slides are not part of tree and would be added twice
+    slideModel->clear();
+
+    // Single changes while loading are neither recorded nor sent,
+    // clients get the whole map instead
+    bool blockSaveStateOrg=blockSaveState;
+    bool blockSendDataOrg=blockSendData;
+    blockSaveState=true;
+    blockSendData=true;
+    restoringMap=true;
+    File::ErrorCode err=loadMap (path, NewMap, VymMap);
+    restoringMap=false;
+    blockSendData=blockSendDataOrg;
+    blockSaveState=blockSaveStateOrg;
+
+    if (!sel.isEmpty() ) select (sel);
+    if (netstate==Server && !blockSendData) sendSnapshot();
+    return err!=File::Aborted;
+}
+
 File::ErrorCode VymModel::save (const SaveMode &savemode)
 {
     QString tmpZipDir;
@@ -737,16 +832,20 @@ File::ErrorCode VymModel::save (const SaveMode &savemode)
     // Create mapName and fileDir
     makeSubDirs (fileDir);
 
-    QString saveFile;
+    // Use defined map name "map.xml", if zipped. Introduce in 2.6.6
+    // Use regular mapName, when saved as XML
+    QString mapFilePath = zipped ? fileDir + "map.xml" : fileDir + mapFileName;
+
+    bool saved;
     if (savemode==CompleteMap || selModel->selection().isEmpty())
     {
 	// Save complete map
         if (zipped)
             // Use defined name for map within zipfile to avoid problems
             //with zip library and umlauts (see #98)
-            saveFile=saveToDir (fileDir, "", true, QPointF(), NULL);
+            saved = saveToDisk (mapFilePath, fileDir, "", true, QPointF(), NULL);
         else
-            saveFile=saveToDir (fileDir, mapName + "-", true, QPointF(), NULL);
+            saved = saveToDisk (mapFilePath, fileDir, mapName + "-", true, QPointF(), NULL);
     mapChanged=false;
 	mapUnsaved=false;
 	autosaveTimer->stop();
@@ -755,23 +854,19 @@ File::ErrorCode VymModel::save (const SaveMode &savemode)
     {
 	// Save part of map
     if (selectionType() == TreeItem::Image)
+        {
 	    saveImage();
+            saved = saveStringToDisk (mapFilePath, QString() );
+        }
 	else	
-        saveFile = saveToDir (fileDir, mapName + "-", true, QPointF(), getSelectedBranch());
+            saved = saveToDisk (mapFilePath, fileDir, mapName + "-", true, QPointF(), getSelectedBranch());
 	// TODO take care of multiselections
     }	
 
-    bool saved;
-    if (zipped)
-        // Use defined map name "map.xml", if zipped. Introduce in 2.6.6
-        saved = saveStringToDisk(fileDir + "map.xml", saveFile);
-    else
-        // Use regular mapName, when saved as XML
-        saved = saveStringToDisk(fileDir + mapFileName, saveFile);
     if (!saved)
     {
 	err=File::Aborted;
-	qWarning ("ME::saveStringToDisk failed!");
+	qWarning ("ME::saveToDisk failed!");
     }
 
     if (zipped)
@@ -1199,6 +1294,13 @@ void VymModel::redo()
     // Can we undo at all?
     if (redosAvail<1) return;
 
+    // Commands would become part of batch
+    if (batchLevel>0)
+    {
+	qWarning ("VM::redo  not possible within batch");
+	return;
+    }
+
     bool blockSaveStateOrg=blockSaveState;
     blockSaveState=true;
     
@@ -1242,9 +1344,23 @@ void VymModel::redo()
     if (!redoSelection.isEmpty())
 	select (redoSelection);
 
-    bool noErr;
+    // Make sure map.xml of this step is available for command
+    spillHistoryData (curStep);
+
+    // Redo of a batch consists of several commands. These may refer 
+    // to local files, so clients get the whole map afterwards
+    bool batchStep=redoCommand.startsWith ("beginBatch");
+    bool blockSendDataOrg=blockSendData;
+    if (batchStep) blockSendData=true;
+
+    bool noErr=true;
     QString errMsg;
-    parseAtom (redoCommand,noErr,errMsg);
+    QStringList atoms=parser.compile (redoCommand);
+    for (int i=0; i<atoms.count() && noErr; i++)
+	parseAtom (atoms.at(i),noErr,errMsg);
+
+    blockSendData=blockSendDataOrg;
+    if (batchStep && netstate==Server && !blockSendData) sendSnapshot();
     if (!noErr) 
     {
 	if (!options.isOn("batch") )
@@ -1283,6 +1399,13 @@ void VymModel::undo()
     // Can we undo at all?
     if (undosAvail<1) return;
 
+    // Commands would become part of batch
+    if (batchLevel>0)
+    {
+	qWarning ("VM::undo  not possible within batch");
+	return;
+    }
+
     mainWindow->statusMessage (tr("Autosave disabled during undo."));
 
     bool blockSaveStateOrg=blockSaveState;
@@ -1330,6 +1453,9 @@ void VymModel::undo()
     if (!undoSelection.isEmpty())
 	select (undoSelection);
 
+    // Make sure map.xml of this step is available for command
+    spillHistoryData (curStep);
+
     // bool noErr;
     QString errMsg;
     //parseAtom (undoCommand,noErr,errMsg);
@@ -1415,6 +1541,11 @@ void VymModel::resetHistory()
     redosAvail=0;
     undosAvail=0;
 
+    historyData.clear();
+    historyDataOrder.clear();
+    historyDataSize=0;
+    historyMemoryBudget=settings.value("/history/memoryBudget",32*1024*1024).toLongLong();
+
     stepsTotal=settings.value("/history/stepsTotal",100).toInt();
     undoSet.setValue ("/history/stepsTotal",QString::number(stepsTotal));
     mainWindow->updateHistory (undoSet);
@@ -1430,7 +1561,13 @@ void VymModel::saveState(
     TreeItem *saveSel, 
     QString dataXML)
 {
-    sendData(redoCom);	//FIXME-4 testing
+    // Commands of a batch have been sent one by one already
+    if (!blockSendData && netstate==Server) 
+    {
+	if (!redoSelection.isEmpty() )
+	    sendData (QString ("select (\"%1\")").arg(redoSelection) );
+	sendData(redoCom);
+    }
 
     // Main saveState
 
@@ -1451,11 +1588,6 @@ void VymModel::saveState(
     if (!d.exists()) 
 	makeSubDirs (histDir);
 
-    // Save depending on how much needs to be saved 
-    QList <Link*> tmpLinks;
-    if (saveSel)
-	dataXML=saveToDir (histDir,mapName+"-",false, QPointF (),saveSel);
-	
     QString undoCommand=undoCom;
     QString redoCommand=redoCom;
     if (savemode==PartOfMap )
@@ -1464,9 +1596,23 @@ void VymModel::saveState(
 	redoCommand.replace ("PATH",bakMapPath);
     }
 
-    if (!dataXML.isEmpty())
-	// Write XML Data to disk
-	saveStringToDisk (bakMapPath,dataXML);
+    // Save depending on how much needs to be saved.
+    // XML data is kept in memory and only written to bakMapPath 
+    // when needed by undo/redo or if memory budget is exceeded.
+    // Images of the saved part are still written to histDir.
+    if (saveSel)
+    {
+	QBuffer buffer;
+	buffer.open (QIODevice::WriteOnly);
+	{
+	    XMLWriter xw (&buffer);
+	    saveToDir (xw, histDir, mapName+"-", false, QPointF (), saveSel);
+	}
+	storeHistoryData (curStep, buffer.data() );
+    } else if (!dataXML.isEmpty())
+	storeHistoryData (curStep, dataXML.toUtf8() );
+    else
+	dropHistoryData (curStep);
 
     // We would have to save all actions in a tree, to keep track of 
     // possible redos after a action. Possible, but we are too lazy: forget about redos.
@@ -1508,6 +1654,42 @@ void VymModel::saveState(
 }
 
 
+void VymModel::storeHistoryData (int step, const QByteArray &data)
+{
+    dropHistoryData (step);
+    historyData.insert (step, data);
+    historyDataOrder.append (step);
+    historyDataSize += data.size();
+
+    // Spill oldest steps to disk, if we use too much memory
+    while (historyDataSize > historyMemoryBudget && historyDataOrder.count() > 1)
+	spillHistoryData (historyDataOrder.first() );
+}
+
+void VymModel::dropHistoryData (int step)
+{
+    if (historyData.contains (step))
+    {
+	historyDataSize -= historyData.value (step).size();
+	historyData.remove (step);
+	historyDataOrder.removeOne (step);
+    }
+}
+
+void VymModel::spillHistoryData (int step)
+{
+    if (!historyData.contains (step)) return;
+
+    QFile file (tmpMapDir + QString("/history-%1/map.xml").arg(step));
+    if (!file.open (QFile::WriteOnly) || file.write (historyData.value (step)) < 0)
+	qWarning()<<"VymModel::spillHistoryData failed for "<<file.fileName();
+    file.close();
+
+    historyDataSize -= historyData.value (step).size();
+    historyData.remove (step);
+    historyDataOrder.removeOne (step);
+}
+
 void VymModel::saveStateChangingPart(TreeItem *undoSel, TreeItem* redoSel, const QString &rc, const QString &comment)
 {
     // save the selected part of the map, Undo will replace part of map 
@@ -1643,25 +1825,39 @@ TreeItem* VymModel::findBySelectString(QString s)
     if (s.isEmpty() ) return NULL;
 
     // Old maps don't have multiple mapcenters and don't save full path
-    if (s.left(2) !="mc") s="mc:0,"+s;
+    if (!s.startsWith ("mc")) s="mc:0,"+s;
 
-    QStringList parts=s.split (",");
-    QString typ;
-    int n;
+    // Parse "typ:n,typ:n,..." in one pass without splitting
     TreeItem *ti=rootItem;
+    const QChar *c=s.constData();
+    const QChar *end=c + s.length();
+    while (c<end)
+    {
+	while (c<end && c->isSpace() ) c++;
+	if (c==end) break;
+	if (end-c<3 || c[2]!=':') return NULL;
+	QChar t0=c[0];
+	QChar t1=c[1];
+	c+=3;
+	int n=0;
+	while (c<end && c->isDigit() )
+	{
+	    n=n*10 + c->digitValue();
+	    c++;
+	}
+	if (c<end)
+	{
+	    if (*c!=',') return NULL;
+	    c++;
+	}
 
-    while (!parts.isEmpty() )
-    {
-	typ=parts.first().left(2);
-	n=parts.first().right(parts.first().length() - 3).toInt();
-	parts.removeFirst();
-	if (typ=="mc" || typ=="bo")
+	if ( (t0=='m' && t1=='c') || (t0=='b' && t1=='o') )
 	    ti=ti->getBranchNum (n);
-	else if (typ=="fi")
+	else if (t0=='f' && t1=='i')
 	    ti=ti->getImageNum (n);
-	else if (typ=="ai")
+	else if (t0=='a' && t1=='i')
 	    ti=ti->getAttributeNum (n);
-	else if (typ=="xl")
+	else if (t0=='x' && t1=='l')
 	    ti=ti->getXLinkItemNum (n);
 	if(!ti) return NULL;	    
     }
@@ -1670,38 +1866,58 @@ TreeItem* VymModel::findBySelectString(QString s)
 
 TreeItem* VymModel::findID (const uint &id)  
 {
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
-    nextBranch(cur,prev);
-    while (cur) 
+    TreeItem *ti=itemIndexID.value (id, NULL);
+    if (ti && (ti->isBranchLikeType() || ti->getType()==TreeItem::Image || ti->getType()==TreeItem::XLink) )
+	return ti;
+    return NULL;
+}
+
+TreeItem* VymModel::findUuid (const QUuid &id)  
+{
+    TreeItem *found=NULL;
+    QMultiHash <QUuid,TreeItem*>::const_iterator it=itemIndexUuid.constFind (id);
+    while (it!=itemIndexUuid.constEnd() && it.key()==id)
     {
-	if (id==cur->getID() ) return cur;
-	int j=0;
-	while (j<cur->xlinkCount() )
-	{
-	    XLinkItem *xli=cur->getXLinkItemNum (j);
-	    if (id==xli->getID() ) return xli;
-	    j++;
-	}
-	j=0;
-	while (j<cur->imageCount() )
+	TreeItem *ti=it.value();
+	if (ti->isBranchLikeType() || ti->getType()==TreeItem::Image || ti->getType()==TreeItem::XLink)
 	{
-	    ImageItem *ii=cur->getImageNum (j);
-	    if (id==ii->getID() ) return ii;
-	    j++;
+	    if (found) return findUuidInTree (id);  // Duplicate uuid, e.g. after paste
+	    found=ti;
 	}
-	nextBranch(cur,prev);
+	++it;
     }
-    return NULL;
+    return found;
 }
 
-TreeItem* VymModel::findUuid (const QUuid &id)  
+void VymModel::registerItem (TreeItem *ti)
+{
+    TreeModel::registerItem (ti);
+    searchIndex->itemChanged (ti);
+    findIndexStale=true;
+    notifyItem (ti, ItemAdded);
+}
+
+void VymModel::unregisterItem (TreeItem *ti)
+{
+    TreeModel::unregisterItem (ti);
+    searchIndex->itemRemoved (ti);
+    spatialIndex->remove (ti);
+    batchChangedItems.remove (ti);
+    notifyItem (ti, ItemRemoved);
+}
+
+void VymModel::searchTextChanged (TreeItem *ti)
 {
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
-    nextBranch(cur,prev);
-    while (cur) 
+    searchIndex->itemChanged (ti);
+    findIndexStale=true;
+}
+
+TreeItem* VymModel::findUuidInTree (const QUuid &id)  
+{
+    BranchIterator it (rootItem);
+    while (it.hasNext() )
     {
+	BranchItem *cur=it.next();
 	if (id==cur->getUuid() ) return cur;
 	int j=0;
 	while (j<cur->xlinkCount() )
@@ -1717,11 +1933,48 @@ TreeItem* VymModel::findUuid (const QUuid &id)
 	    if (id==ii->getUuid() ) return ii;
 	    j++;
 	}
-	nextBranch(cur,prev);
     }
     return NULL;
 }
 
+bool VymModel::checkItemIndex ()
+{
+    // Walk the whole tree and compare with the lookup index
+    bool ok=true;
+    int n=0;
+    QList <TreeItem*> todo;
+    todo.append (rootItem);
+    while (!todo.isEmpty() )
+    {
+	TreeItem *ti=todo.takeLast();
+	n++;
+	if (ti->getModel()!=this)
+	{
+	    qWarning()<<"VM::checkItemIndex  wrong model for"<<ti->getID()<<ti->getHeadingPlain();
+	    ok=false;
+	}
+	if (itemIndexID.value (ti->getID(), NULL)!=ti)
+	{
+	    qWarning()<<"VM::checkItemIndex  ID not indexed:"<<ti->getID()<<ti->getHeadingPlain();
+	    ok=false;
+	}
+	if (!itemIndexUuid.contains (ti->getUuid(), ti))
+	{
+	    qWarning()<<"VM::checkItemIndex  uuid not indexed:"<<ti->getUuid()<<ti->getHeadingPlain();
+	    ok=false;
+	}
+	for (int i=0; i<ti->childCount(); i++)
+	    todo.append (ti->getChildNum (i) );
+    }
+    if (itemIndexID.count()!=n || itemIndexUuid.count()!=n)
+    {
+	qWarning()<<"VM::checkItemIndex  "<<n<<"items in tree, but index has"
+	    <<itemIndexID.count()<<"IDs and"<<itemIndexUuid.count()<<"uuids";
+	ok=false;
+    }
+    return ok;
+}
+
 //////////////////////////////////////////////
 // Interface 
 //////////////////////////////////////////////
@@ -1788,13 +2041,11 @@ QString VymModel::getDate ()
 int VymModel::branchCount() 
 {
     int c=0;
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
-    nextBranch(cur,prev);
-    while (cur) 
+    BranchIterator it (rootItem);
+    while (it.hasNext() )
     {
+	it.next();
 	c++;
-	nextBranch(cur,prev);
     }
     return c;
 }
@@ -1935,15 +2186,13 @@ void VymModel::findDuplicateURLs()  // FIXME-3 needs GUI
     // Generate map containing _all_ URLs and branches
     QString u;
     QMap <QString,BranchItem*> map;
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
-    nextBranch(cur,prev);
-    while (cur) 
+    BranchIterator it (rootItem);
+    while (it.hasNext() )
     {
+	BranchItem *cur=it.next();
 	u=cur->getURL();
 	if (!u.isEmpty() )
 	    map.insertMulti (u,cur);
-	nextBranch(cur,prev);
     }
 
     // Extract duplicate URLs
@@ -1966,6 +2215,48 @@ void VymModel::findDuplicateURLs()  // FIXME-3 needs GUI
     }
 }
 
+typedef QPair <QList <int>, BranchItem*> TreePathItem;
+
+static bool treePathLessThan (const TreePathItem &a, const TreePathItem &b)
+{
+    int n=qMin (a.first.count(), b.first.count() );
+    for (int i=0; i<n; i++)
+	if (a.first.at(i)!=b.first.at(i)) return a.first.at(i) < b.first.at(i);
+    return a.first.count() < b.first.count();
+}
+
+QList <BranchItem*> VymModel::findCandidates (const QString &s)
+{
+    QList <BranchItem*> list;
+    QSet <uint> ids;
+    if (!searchIndex->find (s, ids))
+    {
+	// Nothing to look up in index, check all branches
+	BranchIterator it (rootItem);
+	while (it.hasNext() ) list.append (it.next() );
+	return list;
+    }
+
+    // Sort hits in order of tree
+    QList <TreePathItem> hits;
+    foreach (uint id, ids)
+    {
+	TreeItem *ti=findID (id);
+	if (!ti || !ti->isBranchLikeType() ) continue;
+	TreePathItem tpi;
+	tpi.second=(BranchItem*)ti;
+	while (ti && ti!=rootItem)
+	{
+	    tpi.first.prepend (ti->row() );
+	    ti=ti->parent();
+	}
+	hits.append (tpi);
+    }
+    qSort (hits.begin(), hits.end(), treePathLessThan);
+    foreach (TreePathItem tpi, hits) list.append (tpi.second);
+    return list;
+}
+
 bool  VymModel::findAll (FindResultModel *rmodel, QString s, Qt::CaseSensitivity cs)   
 {
     rmodel->clear();
@@ -1973,19 +2264,22 @@ bool  VymModel::findAll (FindResultModel *rmodel, QString s, Qt::CaseSensitivity
     rmodel->setSearchFlags (0);	//FIXME-4 translate cs to QTextDocument::FindFlag
     bool hit = false;
 
-    BranchItem *cur  = NULL;
-    BranchItem *prev = NULL;
-    nextBranch(cur,prev);
-
     FindResultItem *lastParent = NULL;
-    while (cur) 
+    foreach (BranchItem *cur, findCandidates (s) )
     {
 	lastParent = NULL;
-        if (cur->getHeading().getTextASCII().contains (s,cs))
+        if (cur->getHeading().getTextASCII().contains (s,cs) || 
+	    cur->getURL().contains (s,cs) )
             {
                 lastParent = rmodel->addItem (cur);
                 hit = true;
             }
+	for (int a=0; !lastParent && a<cur->attributeCount(); a++)
+	    if (cur->getAttributeNum(a)->getHeading().getTextASCII().contains (s,cs) )
+	    {
+		lastParent = rmodel->addItem (cur);
+		hit = true;
+	    }
 	QString n = cur->getNoteASCII();
 	int i = 0;
 	int j = 0;
@@ -2015,11 +2309,99 @@ bool  VymModel::findAll (FindResultModel *rmodel, QString s, Qt::CaseSensitivity
 		i++;
 	    }
 	} 
-	nextBranch(cur, prev);
     }
     return hit;
 }
 
+void VymModel::findAllStart (FindResultModel *rmodel, QString s, Qt::CaseSensitivity cs)
+{
+    findAllCancel();
+
+    // Result model is shared by all maps, stop search of previous map
+    VymModel *prev=rmodel->getOwner();
+    if (prev && prev!=this) prev->findAllCancel();
+    rmodel->setOwner (this);
+
+    rmodel->clear();
+    rmodel->setSearchString (s);
+    rmodel->setSearchFlags (0);	//FIXME-4 translate cs to QTextDocument::FindFlag
+    findResultModel=rmodel;
+    findAllHit=false;
+    findAllFirstHit=true;
+    findAllTime.start();
+
+    // Take snapshot of texts, the worker must not access the items.
+    // Copies are cheap, rich text is converted by the worker
+    QList <FindWorker::Entry> entries;
+    foreach (BranchItem *cur, findCandidates (s) )
+    {
+	FindWorker::Entry e;
+	e.id=cur->getID();
+	e.heading=cur->getHeading();
+	e.note=cur->getNote();
+	e.url=cur->getURL();
+	for (int a=0; a<cur->attributeCount(); a++)
+	    e.attributes.append (cur->getAttributeNum(a)->getHeading() );
+	entries.append (e);
+    }
+
+    findWorker=new FindWorker (s, cs, entries, this);
+    connect (findWorker, SIGNAL (resultsReady() ), this, SLOT (findAllResults() ) );
+    connect (findWorker, SIGNAL (finished() ), this, SLOT (findAllDone() ) );
+    findWorker->start();
+}
+
+void VymModel::findAllCancel()
+{
+    if (!findWorker) return;
+
+    // Worker deletes itself in findAllDone, when thread has finished
+    findWorker->cancel();
+    findWorker=NULL;
+}
+
+void VymModel::findAllResults()
+{
+    FindWorker *fw=qobject_cast <FindWorker*> (sender() );
+    if (!fw || fw!=findWorker || !findResultModel) return;  // Canceled meanwhile
+    if (findResultModel->getOwner()!=this)
+    {
+	// Another map uses result model now
+	findAllCancel();
+	return;
+    }
+
+    foreach (FindWorker::Result r, fw->takeResults() )
+    {
+	TreeItem *ti=findID (r.id);
+	if (!ti) continue;	// Deleted meanwhile
+	FindResultItem *lastParent = findResultModel->addItem (ti);
+	findAllHit=true;
+	for (int j=0; j<r.noteHits.count(); j++)
+	    findResultModel->addSubItem (lastParent, QString(tr("Note", "FindAll in VymModel") + ": \"...%1...\"").arg(r.noteHits.at(j)), ti, j);
+    }
+    if (findAllHit && findAllFirstHit)
+    {
+	findAllFirstHit=false;
+	mainWindow->statusMessage (tr("First result found after %1 ms","FindAll in VymModel").arg(findAllTime.elapsed()) );
+    }
+}
+
+void VymModel::findAllDone()
+{
+    FindWorker *fw=qobject_cast <FindWorker*> (sender() );
+    if (!fw) return;
+    if (fw==findWorker)
+    {
+	findAllResults();
+	findWorker=NULL;
+	if (!findAllHit)
+	    mainWindow->statusMessage (tr("Nothing found","FindAll in VymModel") );
+	emit (findAllFinished (findAllHit) );
+    }
+    fw->deleteLater();
+}
+
 BranchItem* VymModel::findText (QString s,Qt::CaseSensitivity cs)
 {
     if (!s.isEmpty() && s!=findString)
@@ -2039,12 +2421,19 @@ BranchItem* VymModel::findText (QString s,Qt::CaseSensitivity cs)
 	findCurrent=NULL;   
 	findPrevious=NULL;  
 	nextBranch (findCurrent,findPrevious);
+	findIndexStale=true;
     }	
+    if (findIndexStale)
+    {
+	// Look up again, branches might have been edited since last step
+	findUseIndex=searchIndex->find (findString, findIndexHits);
+	findIndexStale=false;
+    }
     bool searching=true;
     bool foundNote=false;
     while (searching && !EOFind)
     {
-	if (findCurrent)
+	if (findCurrent && (!findUseIndex || findIndexHits.contains (findCurrent->getID()) ))
 	{
 	    // Searching in Note
         if (findCurrent->getNoteASCII().contains(findString,cs))
@@ -2078,6 +2467,9 @@ BranchItem* VymModel::findText (QString s,Qt::CaseSensitivity cs)
 void VymModel::findReset()
 {   // Necessary if text to find changes during a find process
     findString.clear();
+    findIndexHits.clear();
+    findUseIndex=false;
+    findIndexStale=true;
     findCurrent=NULL;
     findPrevious=NULL;
     EOFind=false;
@@ -2118,14 +2510,12 @@ QStringList VymModel::getURLs(bool ignoreScrolled)
 {
     QStringList urls;
     BranchItem *selbi=getSelectedBranch();
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
-    nextBranch (cur,prev,true,selbi);
-    while (cur) 
+    BranchIterator it (selbi ? selbi : rootItem, BranchIterator::PostOrder);
+    while (it.hasNext() )
     {
+	BranchItem *cur=it.next();
 	if (!cur->getURL().isEmpty()  && !(ignoreScrolled && cur->hasScrolledParent() )) 
 	    urls.append( cur->getURL());
-	nextBranch(cur,prev,true,selbi);
     }	
     return urls;
 }
@@ -2552,9 +2942,8 @@ void VymModel::copy()
 	selti->getType() == TreeItem::Image ))
     {
 	// Copy to global clipboard
-	QString saveFile=saveToDir (clipboardDir, clipboardFile, true, QPointF(), selti);
-	if (!saveStringToDisk(clipboardDir + "/" + clipboardFile,saveFile))
-	    qWarning ("ME::saveStringToDisk failed!");
+	if (!saveToDisk (clipboardDir + "/" + clipboardFile, clipboardDir, clipboardFile, true, QPointF(), selti))
+	    qWarning ("ME::saveToDisk failed!");
 
 	clipboardEmpty=false;
 
@@ -3522,17 +3911,15 @@ void VymModel::unscrollChildren()
 	    QString ("unscrollChildren ()"),
 	    QString ("unscroll all children of %1").arg(getObjectName(selbi))
 	);  
-        BranchItem *prev=NULL;
-        BranchItem *cur=NULL;
-        nextBranch (cur,prev,true,selbi);
-	while (cur) 
+        BranchIterator it (selbi, BranchIterator::PostOrder);
+	while (it.hasNext() )
 	{
+	    BranchItem *cur=it.next();
 	    if (cur->isScrolled())
 	    {
 		cur->toggleScroll(); 
 		emitDataChanged (cur);
             }
-	    nextBranch (cur,prev,true,selbi);
 	}   
 	updateActions();
 	reposition();
@@ -3631,15 +4018,13 @@ ItemList VymModel::getTargets()
     
     //rmodel->setSearchString (s);
 
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
-    nextBranch(cur,prev);
+    BranchIterator it (rootItem);
 
-    while (cur) 
+    while (it.hasNext() )
     {
+	BranchItem *cur=it.next();
 	if (cur->hasActiveSystemFlag("system-target"))
             targets[cur->getID()] = (cur->getHeading()).getTextASCII();
-	nextBranch(cur,prev);
     }
     return targets; 
 }
@@ -3722,14 +4107,12 @@ void VymModel::colorSubtree (QColor c, BranchItem *b)
 	    QString ("colorSubtree (\"%1\")").arg(c.name()),
 	    QString ("Set color of %1 and children to %2").arg(getObjectName(bi)).arg(c.name())
 	);  
-	BranchItem *prev=NULL;
-	BranchItem *cur=NULL;
-        nextBranch (cur,prev,true,bi);
-	while (cur) 
+	BranchIterator it (bi, BranchIterator::PostOrder);
+	while (it.hasNext() )
 	{
+	    BranchItem *cur=it.next();
 	    cur->setHeadingColor(c); // color links, color children
 	    emitDataChanged (cur);
-            nextBranch (cur,prev,true,bi);
 	}   
     }
     taskEditor->showSelection();
@@ -3819,11 +4202,10 @@ void VymModel::getBugzillaData(bool subtree)
     if (selbi)
     {	    
 	QString url;
-	BranchItem *prev=NULL;
-	BranchItem *cur=NULL;
-        nextBranch (cur,prev,true,selbi);
-	while (cur) 
+	BranchIterator it (selbi);
+	while (it.hasNext() )
 	{
+	    BranchItem *cur=it.next();
 	    url=cur->getURL();
 	    if (!url.isEmpty())
 	    {
@@ -3834,10 +4216,7 @@ void VymModel::getBugzillaData(bool subtree)
 		    mainWindow->statusMessage (tr("Contacting Bugzilla...","VymModel"));
 		}
 	    }
-	    if (subtree) 
-		nextBranch (cur,prev,true,selbi);
-	    else
-		cur=NULL;
+	    if (!subtree) break;
 	}   
     }
 }   
@@ -3911,13 +4290,11 @@ QStringList VymModel::getVymLinks()
 {
     QStringList links;
     BranchItem *selbi=getSelectedBranch();
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
-    nextBranch (cur,prev,true,selbi);
-    while (cur) 
+    BranchIterator it (selbi ? selbi : rootItem, BranchIterator::PostOrder);
+    while (it.hasNext() )
     {
+	BranchItem *cur=it.next();
 	if (!cur->getVymLink().isEmpty()) links.append( cur->getVymLink());
-	nextBranch (cur,prev,true,selbi);
     }	
     return links;
 }
@@ -4072,12 +4449,26 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
     // Check set of parameters
     if (parser.errorLevel()==NoError && parser.checkParameters(selti) )
     {
-	QString com=parser.getCommand();
-    // - MS VS2013 compiler has nested if limit - work around that with
-    //   do{}while(0); and breaks
-    do {
+    // Dispatch by id of command, which has been looked up by parser
+    // already, instead of comparing its name with all known commands
+    Command *com=parser.getCommandObj();
+    int id= com ? com->getID() : UnknownCommand;
+
+    // Save map for undo of batch only, if it is really changed
+    if (batchLevel>0 && batchUndoPath.isEmpty() && !isReadOnlyCommand (id) )
+	saveBatchMap();
+
+    switch (id) 
+    {
 	/////////////////////////////////////////////////////////////////////
-	if (com=="addBranch")  
+	case CmdAbortBatch:
+	{
+	    if (!abortBatch() )
+		parser.setError (Aborted,"No batch started");
+	    break;
+	}
+	/////////////////////////////////////////////////////////////////////
+	case CmdAddBranch:
 	{
 	    if (parser.parCount()==0)
 		addNewBranch ();
@@ -4086,20 +4477,20 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="addBranchBefore")
+    case CmdAddBranchBefore:
 	{
 	    addNewBranchBefore ();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com==QString("addMapCenter"))
+    case CmdAddMapCenter:
 	{
 	    x=parser.parDouble (ok,0);
 	    y=parser.parDouble (ok,1);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com==QString("addMapInsert"))
+    case CmdAddMapInsert:
 	{
 	    t=parser.parString (ok,0);  // path to map
 	    int contentFilter=0x0000;
@@ -4133,7 +4524,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com==QString("addMapReplace"))
+    case CmdAddMapReplace:
 	{
 	    t=parser.parString (ok,0);	// path to map
 	    if (QDir::isRelativePath(t)) 
@@ -4144,13 +4535,13 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com==QString("addSlide"))
+    case CmdAddSlide:
 	{
 	    addSlide();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com==QString("addXLink"))
+    case CmdAddXLink:
 	{
 	    s=parser.parString (ok,0);	// begin
 	    t=parser.parString (ok,1);	// end
@@ -4198,19 +4589,37 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="branchCount")
+    case CmdAutoLayout:
+	{ 
+	    // Optional time budget in ms, returns number of collisions left
+	    n=0;
+	    if (parser.parCount()>0) n=parser.parInt (ok,0);
+	    if (n<0)
+		parser.setError (Aborted,"Time budget must not be negative");
+	    else
+		returnValue=mapEditor->autoLayout (n);
+        break;
+    }
+	/////////////////////////////////////////////////////////////////////
+    case CmdBeginBatch:
+	{ 
+	    beginBatch();
+        break;
+    }
+	/////////////////////////////////////////////////////////////////////
+    case CmdBranchCount:
 	{ 
 	    returnValue=selti->branchCount();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="centerCount")
+    case CmdCenterCount:
 	{ 
 	    returnValue=rootItem->branchCount();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="centerOnID")
+    case CmdCenterOnID:
 	{
 	    s=parser.parString(ok,0);
 	    TreeItem *ti=findUuid(QUuid(s));
@@ -4231,7 +4640,13 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="clearFlags")
+    case CmdCheckItemIndex:
+	{ 
+	    returnValue=checkItemIndex();
+        break;
+    }
+	/////////////////////////////////////////////////////////////////////
+    case CmdClearFlags:
     {
         selbi->deactivateAllStandardFlags();
         reposition();
@@ -4240,33 +4655,51 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="colorBranch")
+    case CmdColorBranch:
     {
         QColor c=parser.parColor (ok,0);
         colorBranch (c);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="colorSubtree")
+    case CmdColorSubtree:
     {
         QColor c=parser.parColor (ok,0);
         colorSubtree (c);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="copy")
+    case CmdCommitBatch:
+	{ 
+	    if (!commitBatch() )
+		parser.setError (Aborted,"No batch started");
+        break;
+    }
+	/////////////////////////////////////////////////////////////////////
+    case CmdConnectToServer:
+	{ 
+	    s="localhost";
+	    n=54321;
+	    if (parser.parCount()>0) s=parser.parString (ok,0);
+	    if (parser.parCount()>1) n=parser.parInt (ok,1);
+	    if (!connectToServer (s,n,true) )
+		parser.setError (Aborted,QString("Couldn't connect to %1 port %2").arg(s).arg(n) );
+        break;
+    }
+	/////////////////////////////////////////////////////////////////////
+    case CmdCopy:
 	{
 	    copy();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="cut")
+    case CmdCut:
 	{
 		cut();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="cycleTask")
+    case CmdCycleTask:
 	{
 	    ok=true;
 	    if (parser.parCount()==0) b=false;
@@ -4275,25 +4708,25 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="delete")
+    case CmdDelete:
 	{
 	    deleteSelection();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="deleteKeepChildren")
+    case CmdDeleteKeepChildren:
 	{
 	    deleteKeepChildren();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="deleteChildren")
+    case CmdDeleteChildren:
 	{
 	    deleteChildren();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="deleteSlide")
+    case CmdDeleteSlide:
 	{
 	    n = parser.parInt (ok,0);
 	    if (!ok || n < 0 || n >= slideModel->count() - 1)
@@ -4303,14 +4736,14 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportAO")
+    case CmdExportAO:
 	{
 	    QString fname=parser.parString(ok,0); 
 	    exportAO (fname,false);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportASCII")
+    case CmdExportASCII:
 	{
        QString fname  = parser.parString(ok, 0);
        bool listTasks = parser.parBool(ok, 1);
@@ -4318,14 +4751,14 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
        break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportCSV")
+    case CmdExportCSV:
 	{
 	   QString fname=parser.parString(ok,0); 
 	   exportCSV (fname,false);
        break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportHTML")
+    case CmdExportHTML:
 	{
 	    QString path=parser.parString(ok,0); 
 	    QString fname=parser.parString(ok,1); 
@@ -4333,7 +4766,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportImage")
+    case CmdExportImage:
 	{
 	    QString fname=parser.parString(ok,0); 
 	    QString format="PNG";
@@ -4343,7 +4776,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportImpress")
+    case CmdExportImpress:
 	{
 	    QString fn=parser.parString(ok,0); 
 	    QString cf=parser.parString(ok,1); 
@@ -4351,41 +4784,41 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportLast")
+    case CmdExportLast:
 	{
 	    exportLast ();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportLaTeX")
+    case CmdExportLaTeX:
 	{
 	    QString fname=parser.parString(ok,0); 
 	    exportLaTeX (fname,false);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportOrgMode")
+    case CmdExportOrgMode:
 	{
 	    QString fname=parser.parString(ok,0); 
 	    exportOrgMode (fname,false);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportPDF")
+    case CmdExportPDF:
 	{
 	    QString fname=parser.parString(ok,0); 
 	    exportPDF(fname,false);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportSVG")
+    case CmdExportSVG:
 	{
 	    QString fname=parser.parString(ok,0); 
 	    exportSVG(fname,false);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="exportXML")
+    case CmdExportXML:
 	{
 	    QString dpath=parser.parString(ok,0); 
 	    QString fpath=parser.parString(ok,1); 
@@ -4393,19 +4826,25 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getDestPath")
+    case CmdGetDestPath:
 	{ 
 	    returnValue=getDestPath();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getFileDir")
+    case CmdGetFileDir:
 	{ 
 	    returnValue=getFileDir();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getFrameType")
+    case CmdGetFrameTime:
+	{ 
+	    returnValue=mapEditor->getFrameTime();
+        break;
+    }
+	/////////////////////////////////////////////////////////////////////
+    case CmdGetFrameType:
 	{ 
 	    BranchObj *bo=(BranchObj*)(selbi->getLMO());
 	    if (!bo)
@@ -4415,55 +4854,55 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getHeadingPlainText")
+    case CmdGetHeadingPlainText:
 	{ 
             returnValue = getHeading().getTextASCII();
             break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getHeadingXML")
+    case CmdGetHeadingXML:
 	{ 
             returnValue = getHeading().saveToDir();
             break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getMapAuthor")
+    case CmdGetMapAuthor:
 	{ 
 	    returnValue=author;
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getMapComment")
+    case CmdGetMapComment:
 	{ 
 	    returnValue=comment;
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getMapTitle")
+    case CmdGetMapTitle:
 	{ 
 	    returnValue=title;
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getNotePlainText")
+    case CmdGetNotePlainText:
 	{ 
             returnValue= getNote().getTextASCII();
             break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getNoteXML")
+    case CmdGetNoteXML:
 	{ 
             returnValue= getNote().saveToDir();
             break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getSelectString")
+    case CmdGetSelectString:
 	{ 
 	    returnValue=getSelectString();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getTaskSleepDays")
+    case CmdGetTaskSleepDays:
 	{ 
             Task *task=selbi->getTask();
             if (task)
@@ -4473,68 +4912,68 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
             break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getURL")
+    case CmdGetURL:
 	{ 
 	    returnValue=selti->getURL();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getVymLink")
+    case CmdGetVymLink:
 	{ 
 	    returnValue=selti->getVymLink();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getXLinkColor")
+    case CmdGetXLinkColor:
 	{ 
 	    returnValue=getXLinkColor().name();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getXLinkWidth")
+    case CmdGetXLinkWidth:
 	{ 
 	    returnValue=getXLinkWidth();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getXLinkPenStyle")
+    case CmdGetXLinkPenStyle:
 	{ 
 	    returnValue=penStyleToString( getXLinkPenStyle() );
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getXLinkStyleBegin")
+    case CmdGetXLinkStyleBegin:
 	{ 
 	    returnValue = getXLinkStyleBegin();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="getXLinkStyleEnd")
+    case CmdGetXLinkStyleEnd:
 	{ 
 	    returnValue = getXLinkStyleEnd();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="hasActiveFlag")
+    case CmdHasActiveFlag:
 	{ 
 	    s=parser.parString(ok,0);
 	    returnValue=selti->hasActiveStandardFlag(s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="hasNote")
+    case CmdHasNote:
 	{
 	    returnValue = !getNote().isEmpty();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="hasRichTextNote")
+    case CmdHasRichTextNote:
 	{
 	    returnValue=hasRichTextNote();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="hasTask")
+    case CmdHasTask:
 	{ 
             if (selbi && selbi->getTask() )
                 returnValue=true;
@@ -4543,46 +4982,46 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
             break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="importDir")
+    case CmdImportDir:
 	{
 	    s=parser.parString(ok,0);
 	    importDirInt(s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="isScrolled")
+    case CmdIsScrolled:
 	{
 	    returnValue=selbi->isScrolled();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="loadImage")
+    case CmdLoadImage:
 	{
 	    s=parser.parString(ok,0);
 	    loadImage (selbi,s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="loadNote")
+    case CmdLoadNote:
 	{
 	    s=parser.parString(ok,0);
 	    loadNote (s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="moveDown")
+    case CmdMoveDown:
 	{
 	    moveDown();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="moveUp")
+    case CmdMoveUp:
 	{
 	    moveUp();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="moveSlideUp")
+    case CmdMoveSlideUp:
 	{
 	    n = parser.parInt (ok, 0);
 	    if (!ok || n < 0 || n >= slideModel->count() - 1)
@@ -4592,7 +5031,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="moveSlideDown")
+    case CmdMoveSlideDown:
 	{
 	    n = parser.parInt (ok, 0);
 	    if (!ok || n < 0 || n >= slideModel->count() - 1)
@@ -4602,7 +5041,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="move")
+    case CmdMove:
 	{
 	    x=parser.parDouble (ok,0);
 	    y=parser.parDouble (ok,1);
@@ -4610,7 +5049,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="moveRel")
+    case CmdMoveRel:
 	{
 	    x=parser.parDouble (ok,0);
 	    y=parser.parDouble (ok,1);
@@ -4618,37 +5057,49 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="nop")
+    case CmdNewServer:
 	{
+	    n=54321;
+	    if (parser.parCount()>0) n=parser.parInt (ok,0);
+	    if (!newServer (n) )
+		parser.setError (Aborted,QString("Couldn't start server on port %1").arg(n) );
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="note2URLs")
+    case CmdNop:
+	{
+        break;
+    }
+	/////////////////////////////////////////////////////////////////////
+    case CmdNote2URLs:
 	{
 	    note2URLs();
         break;
     }
         /////////////////////////////////////////////////////////////////////
-    if (com=="parseVymText")
+    case CmdParseVymText:
         {
             s = parser.parString(ok,0);
             parseVymText( s );
         break;
     }
         /////////////////////////////////////////////////////////////////////
-    if (com=="paste")
+    case CmdPaste:
 	{
 	    paste();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="redo")
+    case CmdRedo:
 	{
-	    redo();
+	    if (batchLevel>0)
+		parser.setError (Aborted,"Redo is not possible within batch");
+	    else
+		redo();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="relinkTo")
+    case CmdRelinkTo:
 	{
 	    if (!selti)
 	    {
@@ -4722,7 +5173,22 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="saveImage")
+    case CmdRestoreMap:
+	{
+	    t=parser.parString (ok,0);	// path to map
+	    if (ok)
+	    {
+		if (parser.parCount()>1)
+		    s=parser.parString (ok,1);	// selection
+		else
+		    s.clear();
+		if (!restoreMap (t,s) )
+		    parser.setError (Aborted,QString("Couldn't restore %1").arg(t) );
+	    }
+        break;
+    }
+	/////////////////////////////////////////////////////////////////////
+    case CmdSaveImage:
 	{
 	    ImageItem *ii=getSelectedImage();
 	    s=parser.parString(ok,0);
@@ -4731,21 +5197,21 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="saveNote")
+    case CmdSaveNote:
 	{
 	    s=parser.parString(ok,0);
 	    saveNote (s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="scroll")
+    case CmdScroll:
 	{
 	    if (!scrollBranch (selbi))	
 		parser.setError (Aborted,"Could not scroll branch");
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="select")
+    case CmdSelect:
 	{
 	    s=parser.parString(ok,0);
 	    if (!select (s))
@@ -4753,7 +5219,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="selectID")
+    case CmdSelectID:
 	{
 	    s=parser.parString(ok,0);
 	    if (!selectID (s))
@@ -4761,7 +5227,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="selectLastBranch")
+    case CmdSelectLastBranch:
 	{
 	    BranchItem *bi=selbi->getLastBranch();
 	    if (!bi)
@@ -4770,7 +5236,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="selectLastImage")
+    case CmdSelectLastImage:
 	{
 	    ImageItem *ii=selbi->getLastImage();
 	    if (!ii)
@@ -4779,13 +5245,13 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="selectParent")
+    case CmdSelectParent:
 	{
 	    selectParent ();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="selectLatestAdded")
+    case CmdSelectLatestAdded:
 	{
 	    if (!latestAddedItem)
 	    {
@@ -4798,98 +5264,98 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setFlag")
+    case CmdSetFlag:
 	{
 	    s=parser.parString(ok,0);
 	    selbi->activateStandardFlag(s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setTaskSleep")
+    case CmdSetTaskSleep:
 	{
 	    s=parser.parString(ok,0);
 	    returnValue=setTaskSleep (s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setFrameIncludeChildren")
+    case CmdSetFrameIncludeChildren:
 	{
 	    b=parser.parBool(ok,0);
 	    setFrameIncludeChildren(b);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setFrameType")
+    case CmdSetFrameType:
 	{
 	    s=parser.parString(ok,0);
 	    setFrameType (s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setFramePenColor")
+    case CmdSetFramePenColor:
 	{
 	    QColor c=parser.parColor(ok,0);
 	    setFramePenColor (c);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setFrameBrushColor")
+    case CmdSetFrameBrushColor:
 	{
 	    QColor c=parser.parColor(ok,0);
 	    setFrameBrushColor (c);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setFramePadding")
+    case CmdSetFramePadding:
 	{
 	    n=parser.parInt(ok,0);
 	    setFramePadding(n);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setFrameBorderWidth")
+    case CmdSetFrameBorderWidth:
 	{
 	    n=parser.parInt(ok,0);
 	    setFrameBorderWidth (n);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setHeadingPlainText")
+    case CmdSetHeadingPlainText:
 	{
 	    s=parser.parString (ok,0);
             setHeadingPlainText (s); // FIXME-3  what about RT? Nothing implemented.
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setHideExport")
+    case CmdSetHideExport:
 	{
 	    b=parser.parBool(ok,0);
 	    setHideExport (b);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setIncludeImagesHorizontally")
+    case CmdSetIncludeImagesHorizontally:
 	{ 
 	    b=parser.parBool(ok,0);
 	    setIncludeImagesHor(b);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setIncludeImagesVertically")
+    case CmdSetIncludeImagesVertically:
 	{
 	    b=parser.parBool(ok,0);
 	    if (ok) setIncludeImagesVer(b);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setHideLinkUnselected")
+    case CmdSetHideLinkUnselected:
 	{
 	    b=parser.parBool(ok,0);
 	    setHideLinkUnselected(b);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setMapAnimCurve")
+    case CmdSetMapAnimCurve:
 	{
 	    n=parser.parInt(ok,0);
 	    if (n<0 || n>QEasingCurve::OutInBounce)
@@ -4903,48 +5369,48 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setMapAnimDuration")
+    case CmdSetMapAnimDuration:
 	{
 	    n=parser.parInt(ok,0);
 	    setMapAnimDuration(n);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setMapAuthor")
+    case CmdSetMapAuthor:
 	{
 	    s=parser.parString(ok,0);
 	    setAuthor (s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setMapComment")
+    case CmdSetMapComment:
 	{
 	    s=parser.parString(ok,0);
 	    if (ok) setComment(s);
         break;
     }
-    if (com=="setMapTitle")
+    case CmdSetMapTitle:
 	{
 	    s=parser.parString(ok,0);
 	    if (ok) setTitle(s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setMapBackgroundColor")
+    case CmdSetMapBackgroundColor:
 	{
 	    QColor c=parser.parColor (ok,0);
 	    setMapBackgroundColor (c);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setMapDefLinkColor")
+    case CmdSetMapDefLinkColor:
 	{
 	    QColor c=parser.parColor (ok,0);
 	    setMapDefLinkColor (c);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setMapLinkStyle")
+    case CmdSetMapLinkStyle:
 	{
 	    s=parser.parString (ok,0);
 	    if (!setMapLinkStyle(s) )
@@ -4952,7 +5418,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setMapRotation")
+    case CmdSetMapRotation:
 	{
 	    x=parser.parDouble (ok,0);
 	    setMapRotationAngle(x);
@@ -4960,7 +5426,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setMapZoom")
+    case CmdSetMapZoom:
 	{
 	    x=parser.parDouble (ok,0);
 	    setMapZoomFactor(x);
@@ -4968,7 +5434,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setNotePlainText")
+    case CmdSetNotePlainText:
 	{
 	    s=parser.parString (ok,0);
             VymNote vn;
@@ -4977,7 +5443,7 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setScale")
+    case CmdSetScale:
 	{
 	    x=parser.parDouble (ok,0);
 	    y=parser.parDouble (ok,1);
@@ -4985,70 +5451,70 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setSelectionColor")
+    case CmdSetSelectionColor:
 	{
 	    QColor c=parser.parColor (ok,0);
 	    setSelectionColorInt (c);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setURL")
+    case CmdSetURL:
 	{
 	    s=parser.parString (ok,0);
 	    setURL(s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setVymLink")
+    case CmdSetVymLink:
 	{
 	    s=parser.parString (ok,0);
 	    setVymLink(s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setXLinkColor")
+    case CmdSetXLinkColor:
 	{
 	    s=parser.parString (ok,0);
 	    setXLinkColor(s);     
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setXLinkLineStyle")
+    case CmdSetXLinkLineStyle:
 	{
 	    s=parser.parString (ok,0);
 	    setXLinkLineStyle(s);     
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setXLinkStyleBegin")
+    case CmdSetXLinkStyleBegin:
 	{
 	    s=parser.parString (ok,0);
 	    setXLinkStyleBegin(s);     
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setXLinkStyleEnd")
+    case CmdSetXLinkStyleEnd:
 	{
 	    s=parser.parString (ok,0);
 	    setXLinkStyleEnd(s);     
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="setXLinkWidth")
+    case CmdSetXLinkWidth:
 	{
 	    n=parser.parInt (ok,0);
 	    setXLinkWidth(n);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="sleep")
+    case CmdSleep:
 	{
 	    n=parser.parInt (ok,0);
 	    sleep (n);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="sortChildren")
+    case CmdSortChildren:
 	{
 	    b=false;
 	    if (parser.parCount()==1)
@@ -5057,74 +5523,81 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="toggleFlag")
+    case CmdToggleFlag:
 	{
 	    s=parser.parString(ok,0);
             toggleStandardFlag (s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="toggleFrameIncludeChildren")
+    case CmdToggleFrameIncludeChildren:
 	{
 	    toggleFrameIncludeChildren();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="toggleScroll")
+    case CmdToggleScroll:
 	{
 	    toggleScroll();	
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="toggleTarget")
+    case CmdToggleTarget:
 	{
 	    toggleTarget();	
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="toggleTask")
+    case CmdToggleTask:
 	{
 	    toggleTask();	
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="undo")
+    case CmdUndo:
 	{
-	    undo();
+	    if (batchLevel>0)
+		parser.setError (Aborted,"Undo is not possible within batch");
+	    else
+		undo();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="unscroll")
+    case CmdUnscroll:
 	{
 	    if (!unscrollBranch (selbi))    
 		parser.setError (Aborted,"Could not unscroll branch");
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="unscrollChildren")
+    case CmdUnscrollChildren:
 	{
 	    unscrollChildren ();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="unselectAll")
+    case CmdUnselectAll:
 	{
 	    unselectAll();
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    if (com=="unsetFlag")
+    case CmdUnsetFlag:
 	{
 	    s=parser.parString(ok,0);
 	    selbi->deactivateStandardFlag(s);
         break;
     }
 	/////////////////////////////////////////////////////////////////////
-    //else must be an Unknown command
+    default:
 	    parser.setError (Aborted,"Unknown command");
     break;
 
-    } while(0); // End of do{}while(0); MS VS2013 nested if bug workaround
+    } // end of switch
+
+    // Keep commands of batch for redo
+    if (batchLevel>0 && parser.errorLevel()==NoError && id!=CmdBeginBatch && id!=CmdCommitBatch && id!=CmdAbortBatch)
+	batchAtoms.append (parser.getAtom() );
 
     } // end check set of parameters if
     // Any errors?
@@ -5146,19 +5619,30 @@ QVariant VymModel::parseAtom(const QString &atom, bool &noErr, QString &errorMsg
 
 QVariant VymModel::execute (const QString &script)
 {
-    parser.setScript (script);
-    parser.execute ();
+    // Scripts and their atoms are parsed only once
+    QStringList atoms=parser.compile (script);
     QVariant r;
     bool noErr=true;
     QString errMsg;
-    while (parser.next() && noErr) 
+    int batchLevelOrg=batchLevel;
+    for (int i=0; i<atoms.count() && noErr; i++)
     {
-        r=parseAtom(parser.getAtom(),noErr,errMsg);
+        r=parseAtom(atoms.at(i),noErr,errMsg);
         if (!noErr)
         {
             if (!options.isOn("batch") && !testmode )
                 QMessageBox::warning(0,tr("Warning"),tr("Script aborted:\n%1").arg(errMsg));
             qWarning()<< QString("VM::execute aborted: "+errMsg + "\n" + script);
+
+            // Don't leave a batch open, which has been begun by this script.
+            // An outer batch is left to the caller
+            if (batchLevel>batchLevelOrg)
+            {
+                if (batchLevelOrg==0)
+                    abortBatch();
+                else
+                    batchLevel=batchLevelOrg;
+            }
         }
     }
     return r;
@@ -5367,27 +5851,18 @@ void VymModel::exportXML (QString dpath, QString fpath, bool useDialog)
     mapUnsaved = munsaved;
 
     // write to directory   //FIXME-3 check totalBBox here...
-    QString saveFile=saveToDir (dpath , mname + "-", true, offset, NULL); 
-    QFile file;
-
-    file.setFileName (fpath);
-    if ( !file.open( QIODevice::WriteOnly ) )
+    if (!saveToDisk (fpath, dpath, mname + "-", true, offset, NULL) )
     {
 	// This should neverever happen
 	QMessageBox::critical (
                 0,
                 tr("Critical Export Error"),
-                QString("VymModel::exportXML couldn't open %1").arg(file.fileName())
+                QString("VymModel::exportXML couldn't write %1").arg(fpath)
         );
+	setExportMode (false);
 	return;
     }	
 
-    // Write it finally, and write in UTF8, no matter what 
-    QTextStream ts( &file );
-    ts.setCodec("UTF-8");
-    ts << saveFile;
-    file.close();
-
     setExportMode (false);
 
     ex.completeExport( QString("\"%1\",\"%2\"").arg(dpath).arg(fpath) );
@@ -5643,7 +6118,7 @@ void VymModel::updateNoteFlag()
 
 void VymModel::reposition() //FIXME-4 VM should have no need to reposition, but the views...
 {
-    if (blockReposition) return;
+    if (blockReposition || batchLevel>0) return;
 
     BranchObj *bo;
     for (int i=0;i<rootItem->branchCount(); i++)
@@ -5698,15 +6173,13 @@ bool VymModel::setMapLinkStyle (const QString & s)
     else
 	linkstyle=LinkableMapObj::UndefinedStyle;
 
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
     BranchObj *bo;
-    nextBranch (cur,prev);
-    while (cur) 
+    BranchIterator it (rootItem);
+    while (it.hasNext() )
     {
+	BranchItem *cur=it.next();
 	bo=(BranchObj*)(cur->getLMO() );
 	bo->setLinkStyle(bo->getDefLinkStyle(cur->parent() ));	//FIXME-4 better emit dataCHanged and leave the changes to View
-	nextBranch(cur,prev);
     }
     reposition();
     return true;
@@ -5737,15 +6210,13 @@ void VymModel::setMapDefLinkColor(QColor col)
     );
 
     defLinkColor=col;
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
     BranchObj *bo;
-    nextBranch(cur,prev);
-    while (cur) 
+    BranchIterator it (rootItem);
+    while (it.hasNext() )
     {
+	BranchItem *cur=it.next();
 	bo=(BranchObj*)(cur->getLMO() );
 	bo->setLinkColor();
-	nextBranch(cur,prev);
     }
     updateActions();
 }
@@ -5753,15 +6224,13 @@ void VymModel::setMapDefLinkColor(QColor col)
 void VymModel::setMapLinkColorHintInt()
 {
     // called from setMapLinkColorHint(lch) or at end of parse
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
     BranchObj *bo;
-    nextBranch(cur,prev);
-    while (cur) 
+    BranchIterator it (rootItem);
+    while (it.hasNext() )
     {
+	BranchItem *cur=it.next();
 	bo=(BranchObj*)(cur->getLMO() );
 	bo->setLinkColor();
-	nextBranch(cur,prev);
     }
 }
 
@@ -5777,15 +6246,13 @@ void VymModel::toggleMapLinkColorHint()
 	linkcolorhint=LinkableMapObj::DefaultColor;
     else    
 	linkcolorhint=LinkableMapObj::HeadingColor;
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
     BranchObj *bo;
-    nextBranch(cur,prev);
-    while (cur) 
+    BranchIterator it (rootItem);
+    while (it.hasNext() )
     {
+	BranchItem *cur=it.next();
 	bo=(BranchObj*)(cur->getLMO() );
 	bo->setLinkColor();
-	nextBranch(cur,prev);
     }
 }
 
@@ -5950,30 +6417,266 @@ void VymModel::moveRel (const double &x, const double &y)
 }
 
 
-void VymModel::animate()   
+void VymModel::beginBatch()
 {
-    animationTimer->stop();
-    BranchObj *bo;
-    int i=0;
-    while (i<animObjList.size() )
+    if (batchLevel++ > 0) return;
+
+    // Map is saved for undo not before the first change, see saveBatchMap
+    batchUndoPath.clear();
+    batchSelection=getSelectString();
+    batchAtoms.clear();
+    batchChangedItems.clear();
+
+    batchBlockSaveStateOrg=blockSaveState;
+    blockSaveState=true;
+    mapEditor->setViewportUpdateMode (QGraphicsView::NoViewportUpdate);
+
+    // Changes from GUI would be neither in history nor in batch
+    updateActions();
+}
+
+bool VymModel::commitBatch()
+{
+    if (batchLevel<1) return false;
+    if (--batchLevel > 0) return true;
+
+    blockSaveState=batchBlockSaveStateOrg;
+    mapEditor->setViewportUpdateMode (QGraphicsView::MinimalViewportUpdate);
+
+    // The whole batch is one step in history: Undo restores the 
+    // saved map, redo runs all commands again
+    if (!batchUndoPath.isEmpty() )
     {
-	bo=(BranchObj*)animObjList.at(i);
-	if (!bo->animate())
+	QString uc=QString ("restoreMap (\"%1\",\"%2\")").arg(batchUndoPath).arg(batchSelection);
+	QString rc="beginBatch ();" + batchAtoms.join (";") + ";commitBatch ();";
+
+	blockSendData=true;
+	saveState (
+	    QString(), uc, 
+	    batchSelection, rc, 
+	    QString ("Batch of %1 commands").arg(batchAtoms.count() ) );
+	blockSendData=false;
+    }
+    batchAtoms.clear();
+
+    // Send signals once per changed item and align dirty subtrees
+    foreach (TreeItem *ti, batchChangedItems)
+	emitDataChanged (ti);
+    batchChangedItems.clear();
+    reposition();
+    updateActions();
+    return true;
+}
+
+bool VymModel::abortBatch()
+{
+    if (batchLevel<1) return false;
+
+    // Also nested batches are aborted, restore map without using history
+    batchLevel=0;
+    batchAtoms.clear();
+    batchChangedItems.clear();
+    blockSaveState=batchBlockSaveStateOrg;
+    if (!batchUndoPath.isEmpty() )
+	restoreMap (batchUndoPath, batchSelection);
+
+    mapEditor->setViewportUpdateMode (QGraphicsView::MinimalViewportUpdate);
+    reposition();
+    updateActions();
+    return true;
+}
+
+bool VymModel::isBatchActive()
+{
+    return batchLevel>0;
+}
+
+void VymModel::saveBatchMap()
+{
+    // Keep map as it is now for undo, images need their own directory
+    batchUndoPath=tmpMapDir + QString("/batch-%1").arg(batchCount++);
+    makeSubDirs (batchUndoPath);
+    batchUndoPath+="/map.xml";
+    if (!saveToDisk (batchUndoPath, batchUndoPath.left (batchUndoPath.lastIndexOf ("/")), mapName+"-", false, QPointF(), NULL) )
+	qWarning()<<"VymModel::saveBatchMap  Could not save map for undo";
+}
+
+bool VymModel::isReadOnlyCommand (int id)
+{
+    switch (id)
+    {
+	case CmdAbortBatch:
+	case CmdBeginBatch:
+	case CmdBranchCount:
+	case CmdCenterCount:
+	case CmdCenterOnID:
+	case CmdCheckItemIndex:
+	case CmdCommitBatch:
+	case CmdCopy:
+	case CmdExportAO:
+	case CmdExportASCII:
+	case CmdExportCSV:
+	case CmdExportHTML:
+	case CmdExportImage:
+	case CmdExportImpress:
+	case CmdExportLast:
+	case CmdExportLaTeX:
+	case CmdExportOrgMode:
+	case CmdExportPDF:
+	case CmdExportSVG:
+	case CmdExportXML:
+	case CmdGetDestPath:
+	case CmdGetFileDir:
+	case CmdGetFrameTime:
+	case CmdGetFrameType:
+	case CmdGetHeadingPlainText:
+	case CmdGetHeadingXML:
+	case CmdGetMapAuthor:
+	case CmdGetMapComment:
+	case CmdGetMapTitle:
+	case CmdGetNotePlainText:
+	case CmdGetNoteXML:
+	case CmdGetSelectString:
+	case CmdGetTaskSleepDays:
+	case CmdGetURL:
+	case CmdGetVymLink:
+	case CmdGetXLinkColor:
+	case CmdGetXLinkWidth:
+	case CmdGetXLinkPenStyle:
+	case CmdGetXLinkStyleBegin:
+	case CmdGetXLinkStyleEnd:
+	case CmdHasActiveFlag:
+	case CmdHasNote:
+	case CmdHasRichTextNote:
+	case CmdHasTask:
+	case CmdIsScrolled:
+	case CmdNop:
+	case CmdSaveImage:
+	case CmdSaveNote:
+	case CmdSelect:
+	case CmdSelectID:
+	case CmdSelectLastBranch:
+	case CmdSelectLastImage:
+	case CmdSelectParent:
+	case CmdSelectLatestAdded:
+	case CmdSleep:
+	case CmdUnselectAll:
+	    return true;
+	default:
+	    return false;
+    }
+}
+
+QVariantMap VymModel::getItemData (TreeItem *ti, bool recursive)
+{
+    QVariantMap map;
+    if (!ti) return map;
+
+    map["id"]=ti->getUuid().toString();
+    map["type"]=ti->getTypeName();
+    map["heading"]=ti->getHeadingPlain();
+    map["note"]=ti->getNoteASCII();
+    if (ti->isBranchLikeType() || ti->getType()==TreeItem::Image)
+    {
+	LinkableMapObj *lmo=((MapItem*)ti)->getLMO();
+	if (lmo)
 	{
-	    if (i>=0) 
-	    {	
-		animObjList.removeAt(i);
-		i--;
-	    }
+	    map["x"]=lmo->getAbsPos().x();
+	    map["y"]=lmo->getAbsPos().y();
 	}
-	bo->reposition();
-	i++;
-    } 
-    emitSelectionChanged();
+    }
+    if (ti->isBranchLikeType() )
+    {
+	BranchItem *bi=(BranchItem*)ti;
+	QVariantMap attributes;
+	for (int i=0; i<bi->attributeCount(); i++)
+	{
+	    AttributeItem *ai=bi->getAttributeNum (i);
+	    attributes[ai->getKey()]=ai->getValue().toString();
+	}
+	map["attributes"]=attributes;
+
+	if (recursive)
+	{
+	    QVariantList children;
+	    for (int i=0; i<bi->branchCount(); i++)
+		children.append (getItemData (bi->getBranchNum (i), true) );
+	    for (int i=0; i<bi->imageCount(); i++)
+		children.append (getItemData (bi->getImageNum (i) ) );
+	    map["children"]=children;
+	}
+    }
+    return map;
+}
 
-    if (!animObjList.isEmpty()) animationTimer->start(animationInterval);
+void VymModel::notifyItem (TreeItem *ti, const ItemChange &change)
+{
+    // Signals are collected and sent together, when the
+    // event loop is reached again
+    switch (change)
+    {
+	case ItemAdded:
+	    itemsAddedPending.insert (ti);
+	    break;
+	case ItemChanged:
+	    if (!itemsAddedPending.contains (ti) )
+		itemsChangedPending.insert (ti);
+	    break;
+	case ItemRemoved:
+	    itemsChangedPending.remove (ti);
+	    // Items never announced need no removal either
+	    if (!itemsAddedPending.remove (ti) )
+		itemsRemovedPending.append (ti->getUuid().toString() );
+	    break;
+    }
+    if (!itemNotifyTimer->isActive() ) itemNotifyTimer->start (0);
 }
 
+void VymModel::emitItemNotifications()
+{
+    // Restored items keep their UUID, for receivers they only changed
+    QSet <QString> removedIds=itemsRemovedPending.toSet();
+    QStringList added, changed, removed;
+    foreach (TreeItem *ti, itemsAddedPending)
+    {
+	QString id=ti->getUuid().toString();
+	if (removedIds.remove (id) )
+	    changed.append (id);
+	else
+	    added.append (id);
+    }
+    foreach (TreeItem *ti, itemsChangedPending)
+	changed.append (ti->getUuid().toString() );
+    foreach (QString id, itemsRemovedPending)
+	if (removedIds.contains (id) ) removed.append (id);
+    itemsAddedPending.clear();
+    itemsChangedPending.clear();
+    itemsRemovedPending.clear();
+
+    if (!removed.isEmpty() ) emit (itemsRemoved (removed) );
+    if (!added.isEmpty() ) emit (itemsAdded (added) );
+    if (!changed.isEmpty() ) emit (itemsChanged (changed) );
+}
+
+void VymModel::animate()   
+{
+    // Ticks have a fixed length, so if a frame took longer
+    // several ticks are done at once 
+    qint64 due=animationClock.elapsed() / animationInterval;
+    uint ticks=qMax (due - animationTicksDone, (qint64)1);
+    animationTicksDone=qMax (due, animationTicksDone + 1);
+
+    // Advance all objects first, then reposition only once per frame
+    QMutableSetIterator <MapObj*> it (animObjects);
+    while (it.hasNext() )
+    {
+	BranchObj *bo=(BranchObj*)it.next();
+	if (!bo->animate (ticks) ) it.remove();
+    } 
+    reposition();
+
+    if (animObjects.isEmpty()) animationTimer->stop();
+}
 
 void VymModel::startAnimation(BranchObj *bo, const QPointF &v)
 {
@@ -5996,31 +6699,32 @@ void VymModel::startAnimation(BranchObj *bo, const QPointF &start, const QPointF
 	ap.setTicks (animationTicks);
 	ap.setAnimated (true);
 	bo->setAnimation (ap);
-	if (!animObjList.contains(bo))
-	    animObjList.append( bo );
-	animationTimer->setSingleShot (true);
-	animationTimer->start(animationInterval);
+	animObjects.insert (bo);
+	if (!animationTimer->isActive() )
+	{
+	    animationClock.start();
+	    animationTicksDone=0;
+	    animationTimer->start (1000 / animationFrameRate);
+	}
     }
 }
 
 void VymModel::stopAnimation (MapObj *mo)
 {
-    int i=animObjList.indexOf(mo);
-    if (i>=0)
-	animObjList.removeAt (i);
+    animObjects.remove (mo);
+    if (animObjects.isEmpty()) animationTimer->stop();
 }
 
 void VymModel::stopAllAnimation ()
 {
-    BranchObj *bo;
-    int i=0;
-    while (i<animObjList.size() )
+    foreach (MapObj *mo, animObjects)
     {
-	bo=(BranchObj*)animObjList.at(i);
+	BranchObj *bo=(BranchObj*)mo;
 	bo->stopAnimation();
 	bo->requestReposition();
-	i++;
     } 
+    animObjects.clear();
+    animationTimer->stop();
     reposition();
 }
 
@@ -6030,113 +6734,295 @@ void VymModel::sendSelection()
     sendData (QString("select (\"%1\")").arg(getSelectString()) );
 }
 
-void VymModel::newServer()
+bool VymModel::newServer(int p)
 {
-    port=54321;
+    if (netstate!=Offline)
+    {
+	qWarning()<<"VM::newServer  map is already connected";
+	return false;
+    }
+    port=p;
     sendCounter=0;
+    sendHistory.clear();
     tcpServer = new QTcpServer(this);
     if (!tcpServer->listen(QHostAddress::Any,port)) {
-        QMessageBox::critical(NULL, "vym server",
-                              QString("Unable to start the server: %1.").arg(tcpServer->errorString()));
-        //FIXME-3 needed? we are no widget any longer... close();
-        return;
+        qWarning()<<"VM::newServer  Unable to start the server:"<<tcpServer->errorString();
+        delete tcpServer;
+        tcpServer=NULL;
+        return false;
     }
     connect(tcpServer, SIGNAL(newConnection()), this, SLOT(newClient()));
     netstate=Server;
     qDebug()<<"Server is running on port "<<tcpServer->serverPort();
+    return true;
 }
 
-void VymModel::connectToServer()
+bool VymModel::connectToServer(const QString &host, int p, bool wait)
 {
-    port=54321;
-    server="salam.suse.de";
-    server="localhost";
+    if (netstate!=Offline)
+    {
+	qWarning()<<"VM::connectToServer  map is already connected";
+	return false;
+    }
+    port=p;
+    server=host;
+    receiveCounter=0;
     clientSocket = new QTcpSocket (this);
     clientSocket->abort();
-    clientSocket->connectToHost(server ,port);
+    connect(clientSocket, SIGNAL(connected()), this, SLOT(sendHello()));
     connect(clientSocket, SIGNAL(readyRead()), this, SLOT(readData()));
     connect(clientSocket, SIGNAL(error(QAbstractSocket::SocketError)),
             this, SLOT(displayNetworkError(QAbstractSocket::SocketError)));
     netstate=Client;	    
-    qDebug()<<"connected to "<<qPrintable (server)<<" port "<<port;
+    clientSocket->connectToHost(server ,port);
+    if (!wait) return true;
 
-    
+    // Scripts need to know the result, so wait a little. Errors 
+    // meanwhile are handled in displayNetworkError, but not shown
+    connectWaiting=true;
+    QTcpSocket *socket=clientSocket;
+    bool ok=socket->waitForConnected (2000);
+    connectWaiting=false;
+    if (ok)
+    {
+	qDebug()<<"connected to "<<qPrintable (server)<<" port "<<port;
+	return true;
+    }
+    qWarning()<<"VM::connectToServer  "<<socket->errorString();
+    if (clientSocket)
+    {
+	// Timeout without error
+	clientSocket->abort();
+	clientSocket->deleteLater();
+	clientSocket=NULL;
+	netstate=Offline;
+    }
+    return false;
 }
 
 void VymModel::newClient()
 {
     QTcpSocket *newClient = tcpServer->nextPendingConnection();
     connect(newClient, SIGNAL(disconnected()),
-            newClient, SLOT(deleteLater()));
+            this, SLOT(clientDisconnected()));
+    connect(newClient, SIGNAL(readyRead()), this, SLOT(readClientData()));
 
     qDebug() <<"ME::newClient  at "<<qPrintable( newClient->peerAddress().toString() );
 
-    clientList.append (newClient);
+    // Client is added to clientList after Hello
 }
 
-
-void VymModel::sendData(const QString &s)
+void VymModel::clientDisconnected()
 {
-    if (clientList.size()==0) return;
+    QTcpSocket *socket=qobject_cast <QTcpSocket*> (sender());
+    if (!socket) return;
+    clientList.removeAll (socket);
+    clientAcked.remove (socket);
+    socket->deleteLater();
+}
 
-    // Create bytearray to send
+QByteArray VymModel::netFrame (const NetFrame &type, quint32 seq, const QStringList &data)
+{
     QByteArray block;
     QDataStream out(&block, QIODevice::WriteOnly);
     out.setVersion(QDataStream::Qt_4_0);
 
-    // Reserve some space for blocksize
-    out << (quint16)0;
+    // Reserve some space for size of frame
+    out << (quint32)0;
+    out << (quint8)type << seq << data;
 
-    // Write sendCounter
-    out << sendCounter++;
+    // Go back and write size without size field itself
+    out.device()->seek(0);
+    out << (quint32)(block.size() - sizeof(quint32));
+    return block;
+}
 
-    // Write data
-    out << s;
+bool VymModel::readNetFrame (QTcpSocket *socket, NetFrame &type, quint32 &seq, QStringList &data)
+{
+    // Wait until the complete frame has arrived
+    if (socket->bytesAvailable() < (int)sizeof(quint32) ) return false;
+    quint32 size;
+    QDataStream peek (socket->peek (sizeof(quint32)));
+    peek.setVersion(QDataStream::Qt_4_0);
+    peek >> size;
+    if (socket->bytesAvailable() < (qint64)(size + sizeof(quint32)) ) return false;
 
-    // Go back and write blocksize so far
-    out.device()->seek(0);
-    quint16 bs=(quint16)(block.size() - 2*sizeof(quint16));
-    out << bs;
+    QDataStream in(socket);
+    in.setVersion(QDataStream::Qt_4_0);
+    quint8 t;
+    in >> size >> t >> seq >> data;
+    type=(NetFrame)t;
+    return true;
+}
 
+void VymModel::sendData(const QString &s)
+{
+    // Bursts of commands, e.g. from scripts, are sent as one delta,
+    // when the event loop is reached again
+    if (netstate!=Server) return;
+    sendQueue.append (s);
+    if (!sendTimer->isActive() ) sendTimer->start (0);
+}
+
+void VymModel::sendQueued()
+{
+    if (sendQueue.isEmpty() ) return;
+
+    QByteArray block=netFrame (NetDelta, ++sendCounter, sendQueue);
     if (debug)
-	qDebug() << "ME::sendData  bs="<<bs<<"  counter="<<sendCounter<<"  s="<<qPrintable(s);
+	qDebug() << "VM::sendQueued  seq="<<sendCounter<<"  commands="<<sendQueue.count()<<"  bytes="<<block.size();
+    sendQueue.clear();
 
-    for (int i=0; i<clientList.size(); ++i)
+    // Keep recent deltas for clients reconnecting later. Deltas applied 
+    // by all clients are dropped, unless a client just connected
+    sendHistory.append (block);
+    int n=0;
+    if (!clientList.isEmpty() )
     {
-	//qDebug() << "Sending \""<<qPrintable (s)<<"\" to "<<qPrintable (clientList.at(i)->peerAddress().toString());
-	clientList.at(i)->write (block);
+	quint32 acked=sendCounter;
+	foreach (QTcpSocket *socket, clientList)
+	    acked=qMin (acked, clientAcked.value (socket, 0) );
+	n=sendHistory.count() - (int)(sendCounter - acked);
     }
+    n=qMax (n, sendHistory.count() - 1000);
+    if (n>0) sendHistory=sendHistory.mid (n);
+
+    foreach (QTcpSocket *socket, clientList)
+	socket->write (block);
 }
 
-void VymModel::readData ()
+void VymModel::sendSnapshot (QTcpSocket *socket)
 {
-    while (clientSocket->bytesAvailable() >=(int)sizeof(quint16) )
+    // Map is sent with sequence number of last delta, images are local
+    // to the server and not included so far
+    sendQueued();
+    QString dir=tmpMapDir + "/net";
+    makeSubDirs (dir);
+    QString xml=saveToDir (dir, mapName+"-", false, QPointF(), NULL);
+    QByteArray block=netFrame (NetSnapshot, sendCounter, QStringList (xml) );
+
+    if (socket)
+	socket->write (block);
+    else
+	foreach (QTcpSocket *s, clientList)
+	    s->write (block);
+}
+
+void VymModel::readClientData()
+{
+    QTcpSocket *socket=qobject_cast <QTcpSocket*> (sender());
+    if (!socket) return;
+
+    NetFrame type;
+    quint32 seq;
+    QStringList data;
+    while (readNetFrame (socket, type, seq, data) )
     {
-	if (debug)
-	    qDebug() <<"readData  bytesAvail="<<clientSocket->bytesAvailable();
-	quint16 recCounter;
-	quint16 blockSize;
+	if (type==NetAck)
+	    clientAcked[socket]=seq;
+	else if (type==NetHello)
+	{
+	    if (debug) qDebug() << "VM::readClientData  Hello seq="<<seq;
+	    sendQueued();
 
-	QDataStream in(clientSocket);
-	in.setVersion(QDataStream::Qt_4_0);
+	    // Send missing deltas, if still available, otherwise whole map
+	    quint32 first=sendCounter - sendHistory.count() + 1;
+	    if (seq>0 && seq+1>=first && seq<=sendCounter)
+	    {
+		for (int i=seq + 1 - first; i<sendHistory.count(); i++)
+		    socket->write (sendHistory.at(i) );
+	    } else
+	    {
+		sendSnapshot (socket);
+		seq=sendCounter;
+	    }
+	    clientAcked[socket]=seq;
+	    if (!clientList.contains (socket) ) clientList.append (socket);
+	} else
+	    qWarning()<<"VM::readClientData  unexpected frame type"<<type;
+    }
+}
 
-	in >> blockSize;
-	in >> recCounter;
-	
-	QString t;
-	in >>t;
-	if (debug)
-	    qDebug() << "VymModel::readData  command="<<qPrintable (t);
-	bool noErr;
-	QString errMsg;
-	parseAtom (t,noErr,errMsg);
+void VymModel::sendHello()
+{
+    clientSocket->write (netFrame (NetHello, receiveCounter, QStringList() ) );
+}
+
+void VymModel::applySnapshot (const QString &xml)
+{
+    QString path=tmpMapDir + "/net-snapshot.xml";
+    QFile file (path);
+    if (!file.open (QIODevice::WriteOnly) )
+    {
+	qWarning()<<"VM::applySnapshot  Could not write "<<path;
+	return;
+    }
+    file.write (xml.toUtf8() );
+    file.close();
+    restoreMap (path);
+}
+
+void VymModel::readData ()
+{
+    NetFrame type;
+    quint32 seq;
+    QStringList data;
+    quint32 counterOrg=receiveCounter;
+    bool resync=false;
 
+    // Changes from server are not part of local history
+    bool blockSaveStateOrg=blockSaveState;
+    blockSaveState=true;
+    while (readNetFrame (clientSocket, type, seq, data) )
+    {
+	if (debug)
+	    qDebug() << "VM::readData  type="<<type<<"  seq="<<seq<<"  items="<<data.count();
+	if (type==NetSnapshot && !data.isEmpty() )
+	{
+	    applySnapshot (data.first() );
+	    receiveCounter=seq;
+	} else if (type==NetDelta)
+	{
+	    if (seq<=receiveCounter) continue;	// Already applied
+	    if (seq>receiveCounter + 1)
+	    {
+		// Missed deltas, ask server once for them or a new snapshot
+		if (!resync)
+		{
+		    qWarning()<<"VM::readData  expected delta"<<receiveCounter + 1<<"but got"<<seq;
+		    sendHello();
+		    resync=true;
+		}
+		continue;
+	    }
+	    execute (data.join (";") );
+	    receiveCounter=seq;
+	}
     }
-    return;
+    blockSaveState=blockSaveStateOrg;
+
+    if (receiveCounter!=counterOrg)
+	clientSocket->write (netFrame (NetAck, receiveCounter, QStringList() ) );
 }
 
 void VymModel::displayNetworkError(QAbstractSocket::SocketError socketError)
 {
+    QTcpSocket *socket=qobject_cast <QTcpSocket*> (sender());
+    if (!socket) return;
+
+    // Connection failed or was lost, map is offline again
+    bool wasConnected=(socket->state()==QAbstractSocket::ConnectedState);
+    QString errorString=socket->errorString();
+    if (!wasConnected && socket==clientSocket)
+    {
+	clientSocket->deleteLater();
+	clientSocket=NULL;
+	netstate=Offline;
+    }
+
+    qWarning()<<"VM::displayNetworkError "<<errorString;
+    if (connectWaiting || testmode || options.isOn("batch") ) return;
+
     switch (socketError) {
     case QAbstractSocket::RemoteHostClosedError:
         break;
@@ -6155,7 +7041,7 @@ void VymModel::displayNetworkError(QAbstractSocket::SocketError socketError)
     default:
         QMessageBox::information(NULL, vymName + " Network client",
                                  QString("The following error occurred: %1.")
-                                 .arg(clientSocket->errorString()));
+                                 .arg(errorString));
     }
 }
 
@@ -6486,8 +7372,15 @@ void VymModel::emitNoteChanged (TreeItem *ti)
 
 void VymModel::emitDataChanged (TreeItem *ti)    
 {
+    // Within a batch signals are sent once per item in commitBatch
+    if (batchLevel>0)
+    {
+	batchChangedItems.insert (ti);
+	return;
+    }
     QModelIndex ix=index(ti);
     emit ( dataChanged (ix,ix) );
+    notifyItem (ti, ItemChanged);
     if (!blockReposition)
     {
         if ( ti->isBranchLikeType() && ((BranchItem*)ti)->getTask()  )
@@ -6734,21 +7627,22 @@ QString VymModel::getSelectString (TreeItem *ti)
 {
     QString s;
     if (!ti || ti->depth()<0) return s;    
-    switch (ti->getType())
+
+    // Collect cached segments up to mapcenter, then join them
+    QList <TreeItem*> path;
+    int len=0;
+    while (ti && ti!=rootItem)
     {
-	case TreeItem::MapCenter: s="mc:"; break;
-	case TreeItem::Branch: s="bo:";break;
-	case TreeItem::Image: s="fi:";break;
-	case TreeItem::Attribute: s="ai:";break;
-	case TreeItem::XLink: s="xl:";break;
-	default:
-	    s="unknown type in VymModel::getSelectString()";
-	    break;
+	path.prepend (ti);
+	len+=ti->getSelectSegment().length() + 1;
+	ti=ti->parent();
+    }
+    s.reserve (len);
+    for (int i=0; i<path.count(); i++)
+    {
+	if (i>0) s+=',';
+	s+=path.at(i)->getSelectSegment();
     }
-    s=  s + QString("%1").arg(ti->num());
-    if (ti->depth() >0)
-	// call myself recursively
-	s= getSelectString(ti->parent()) +","+s;
     return s;
 }
 
@@ -3,7 +3,9 @@
 
 #include <QtNetwork>
 
+#include <QElapsedTimer>
 #include <QPointF>
+#include <QSet>
 #include <QTextCursor>
 
 #if defined(VYM_DBUS)
@@ -22,12 +24,16 @@
 class AttributeItem;
 class BranchItem;
 class FindResultModel;
+class FindWorker;
 class Link;
 class MapEditor;
+class SearchIndex;
 class SlideItem;
+class SpatialIndex;
 class SlideModel;
 class Task;
 class XLinkItem;
+class XMLWriter;
 class VymView;
 
 class QGraphicsScene;
@@ -59,11 +65,13 @@ public:
     void makeTmpDirectories();	    //!< create temporary directories e.g. for history
 
     MapEditor* getMapEditor();		
+    SpatialIndex* getSpatialIndex();	//! Areas of visible objects for hit testing in MapEditor
     uint getModelID();			//! Return unique ID of model
 
     void setView (VymView*);	    //! Set vymView for resizing editors after load
 private:
     VymView *vymView;
+    SpatialIndex *spatialIndex;
 
 public:
     bool isRepositionBlocked();	    //!< While load or undo there is no need to update graphicsview
@@ -102,13 +110,19 @@ private:
 public:
     /*! This function saves all information of the map to disc.
 	saveToDir also calls the functions for all BranchObj and other objects in the map.
-	The structure of the map itself is returned as QString and passed back to Main, 
-	where saveToDir is called initially
+	The structure of the map itself is streamed to the XMLWriter, which 
+	is threaded through the whole tree.
     */	
+    void saveToDir (XMLWriter &xw, const QString &tmpdir, const QString &prefix, bool writeflags, const QPointF &offset, TreeItem *saveSel);
+
+    /*! Same as above, but returns the XML as QString */
     QString saveToDir (const QString &tmpdir, const QString &prefix, bool writeflags, const QPointF &offset, TreeItem *saveSel);
 
+    /*! Stream XML directly into file fname */
+    bool saveToDisk (const QString &fname, const QString &tmpdir, const QString &prefix, bool writeflags, const QPointF &offset, TreeItem *saveSel);
+
     /*! Save all data in tree*/
-    QString saveTreeToDir (const QString&,const QString&,const QPointF&,QList <Link*> &tmpLinks);// Save data recursivly to tempdir
+    void saveTreeToDir (XMLWriter &xw, const QString&,const QString&,const QPointF&,QList <Link*> &tmpLinks);// Save data recursivly to tempdir
 
 
     /*! \brief Sets filepath, filename and mapname
@@ -146,6 +160,15 @@ public:
 	int pos=-1			//!< Optionally tell position where to add data
     );	
 
+    /*! \brief Replace whole map by a map saved before
+
+	In contrast to loading a new map the UUIDs, slides and map settings 
+	are restored, while history, lockfile and file state are kept.
+    */	
+    bool restoreMap (const QString &path, const QString &sel=QString());
+private:
+    bool restoringMap;		//!< loadMap called by restoreMap
+
 public:
     /*! \brief Save the map to file */
     File::ErrorCode save(const SaveMode &);	
@@ -190,6 +213,14 @@ private:
     int undosAvail;		//!< Available number of undo steps
     bool blockReposition;	//!< block while load or undo
     bool blockSaveState;	//!< block while load or undo
+
+    QHash <int,QByteArray> historyData;	//!< map.xml of history steps kept in memory
+    QList <int> historyDataOrder;	//!< steps in historyData, oldest first
+    qint64 historyDataSize;		//!< Total size of historyData
+    qint64 historyMemoryBudget;		//!< historyData beyond this size is spilled to disk
+    void storeHistoryData (int step, const QByteArray &data);
+    void dropHistoryData (int step);
+    void spillHistoryData (int step);	//!< Write map.xml of step to disk, if still in memory
 public:
     bool isDefault();		//!< true, if map is still the empty default map
     void makeDefault();		//!< Reset changelog, declare this as default map
@@ -291,6 +322,12 @@ public:
     TreeItem* findBySelectString (QString s);	    
     TreeItem* findID   (const uint &i);	    // find MapObj by unique ID
     TreeItem* findUuid (const QUuid &i);    // find MapObj by unique ID
+    bool checkItemIndex ();		    //!< Consistency check of ID/uuid index, used in testmode
+    void registerItem (TreeItem *ti);	    //!< Overloaded to update search index
+    void unregisterItem (TreeItem *ti);	    //!< Overloaded to update search and spatial index
+    void searchTextChanged (TreeItem *ti);  //!< Heading, note, URL or attribute changed
+private:
+    TreeItem* findUuidInTree (const QUuid &i);	// Slow walk, if uuid is not unique
 
 
 ////////////////////////////////////////////
@@ -333,10 +370,27 @@ private:
 public:
     void findDuplicateURLs();		    // find duplicate URLs, testing only so far
     bool findAll (FindResultModel*, QString s, Qt::CaseSensitivity cs=Qt::CaseInsensitive);	// Search all objects at once, also notes
+    void findAllStart (FindResultModel*, QString s, Qt::CaseSensitivity cs=Qt::CaseInsensitive);	// Like findAll, but in background
+    void findAllCancel();		    // Stop background search
     BranchItem* findText(QString s,Qt::CaseSensitivity cs); // Find object, also in note
     void findReset();			    // Reset Search
+signals:
+    void findAllFinished (bool hit);	    // Background search is done
+private slots:
+    void findAllResults();
+    void findAllDone();
 private:    
+    FindWorker *findWorker;
+    FindResultModel *findResultModel;
+    bool findAllHit;
+    bool findAllFirstHit;
+    QElapsedTimer findAllTime;
     QString findString;
+    SearchIndex *searchIndex;
+    QSet <uint> findIndexHits;		    // Branches found by searchIndex for findString
+    bool findUseIndex;
+    bool findIndexStale;		    // Text changed since findIndexHits were looked up
+    QList <BranchItem*> findCandidates (const QString &s);  // Branches possibly containing s
 
 public:
     void setURL(QString url);
@@ -515,6 +569,145 @@ public:
 // Scripting
 ////////////////////////////////////////////
 public:	
+    /*! Ids of script commands, set for each Command in Main::setupAPI
+	and used to dispatch in parseAtom */
+    enum ScriptCommand {
+	UnknownCommand,
+	CmdAbortBatch,
+	CmdAddBranch,
+	CmdAddBranchBefore,
+	CmdAddMapCenter,
+	CmdAddMapInsert,
+	CmdAddMapReplace,
+	CmdAddSlide,
+	CmdAddXLink,
+	CmdAutoLayout,
+	CmdBeginBatch,
+	CmdBranchCount,
+	CmdCenterCount,
+	CmdCenterOnID,
+	CmdCheckItemIndex,
+	CmdClearFlags,
+	CmdColorBranch,
+	CmdColorSubtree,
+	CmdCommitBatch,
+	CmdConnectToServer,
+	CmdCopy,
+	CmdCut,
+	CmdCycleTask,
+	CmdDelete,
+	CmdDeleteKeepChildren,
+	CmdDeleteChildren,
+	CmdDeleteSlide,
+	CmdExportAO,
+	CmdExportASCII,
+	CmdExportCSV,
+	CmdExportHTML,
+	CmdExportImage,
+	CmdExportImpress,
+	CmdExportLast,
+	CmdExportLaTeX,
+	CmdExportOrgMode,
+	CmdExportPDF,
+	CmdExportSVG,
+	CmdExportXML,
+	CmdGetDestPath,
+	CmdGetFileDir,
+	CmdGetFrameTime,
+	CmdGetFrameType,
+	CmdGetHeadingPlainText,
+	CmdGetHeadingXML,
+	CmdGetMapAuthor,
+	CmdGetMapComment,
+	CmdGetMapTitle,
+	CmdGetNotePlainText,
+	CmdGetNoteXML,
+	CmdGetSelectString,
+	CmdGetTaskSleepDays,
+	CmdGetURL,
+	CmdGetVymLink,
+	CmdGetXLinkColor,
+	CmdGetXLinkWidth,
+	CmdGetXLinkPenStyle,
+	CmdGetXLinkStyleBegin,
+	CmdGetXLinkStyleEnd,
+	CmdHasActiveFlag,
+	CmdHasNote,
+	CmdHasRichTextNote,
+	CmdHasTask,
+	CmdImportDir,
+	CmdIsScrolled,
+	CmdLoadImage,
+	CmdLoadNote,
+	CmdMoveDown,
+	CmdMoveUp,
+	CmdMoveSlideUp,
+	CmdMoveSlideDown,
+	CmdMove,
+	CmdMoveRel,
+	CmdNewServer,
+	CmdNop,
+	CmdNote2URLs,
+	CmdParseVymText,
+	CmdPaste,
+	CmdRedo,
+	CmdRelinkTo,
+	CmdRestoreMap,
+	CmdSaveImage,
+	CmdSaveNote,
+	CmdScroll,
+	CmdSelect,
+	CmdSelectID,
+	CmdSelectLastBranch,
+	CmdSelectLastImage,
+	CmdSelectParent,
+	CmdSelectLatestAdded,
+	CmdSetFlag,
+	CmdSetTaskSleep,
+	CmdSetFrameIncludeChildren,
+	CmdSetFrameType,
+	CmdSetFramePenColor,
+	CmdSetFrameBrushColor,
+	CmdSetFramePadding,
+	CmdSetFrameBorderWidth,
+	CmdSetHeadingPlainText,
+	CmdSetHideExport,
+	CmdSetIncludeImagesHorizontally,
+	CmdSetIncludeImagesVertically,
+	CmdSetHideLinkUnselected,
+	CmdSetMapAnimCurve,
+	CmdSetMapAnimDuration,
+	CmdSetMapAuthor,
+	CmdSetMapComment,
+	CmdSetMapTitle,
+	CmdSetMapBackgroundColor,
+	CmdSetMapDefLinkColor,
+	CmdSetMapLinkStyle,
+	CmdSetMapRotation,
+	CmdSetMapZoom,
+	CmdSetNotePlainText,
+	CmdSetScale,
+	CmdSetSelectionColor,
+	CmdSetURL,
+	CmdSetVymLink,
+	CmdSetXLinkColor,
+	CmdSetXLinkLineStyle,
+	CmdSetXLinkStyleBegin,
+	CmdSetXLinkStyleEnd,
+	CmdSetXLinkWidth,
+	CmdSleep,
+	CmdSortChildren,
+	CmdToggleFlag,
+	CmdToggleFrameIncludeChildren,
+	CmdToggleScroll,
+	CmdToggleTarget,
+	CmdToggleTask,
+	CmdUndo,
+	CmdUnscroll,
+	CmdUnscrollChildren,
+	CmdUnselectAll,
+	CmdUnsetFlag,
+    };
 
     /* \brief Process one command and its parameters */
     QVariant parseAtom (const QString &atom, bool &noError, QString &errorMsg);	
@@ -658,19 +851,61 @@ public:
     /*!  Move relativly to (x,y).  */	
     void moveRel (const double &x, const double &y);
 
+////////////////////////////////////////////
+// Batch mode
+////////////////////////////////////////////
+public:
+    void beginBatch();		    //!< Defer undo, reposition and signals until commitBatch
+    bool commitBatch();		    //!< Returns false, if no batch was started
+    bool abortBatch();		    //!< Restore map as before beginBatch
+    bool isBatchActive();
+private:
+    void saveBatchMap();	    //!< Called before first change in batch
+    bool isReadOnlyCommand (int id);//!< Script command doesn't change map
+    int batchLevel;		    // nested begins
+    int batchCount;		    // used for unique directories
+    bool batchBlockSaveStateOrg;
+    bool blockSendData;		    // changes reach clients by other means
+    QString batchUndoPath;	    // map before batch
+    QString batchSelection;	    // selection before batch
+    QStringList batchAtoms;	    // executed commands, used for redo
+    QSet <TreeItem*> batchChangedItems;
+
+////////////////////////////////////////////
+// Bulk access and change notification, e.g. for DBUS
+////////////////////////////////////////////
+public:
+    QVariantMap getItemData (TreeItem *ti, bool recursive=false);   //!< Heading, note, attributes, optionally children
+signals:
+    void itemsAdded   (const QStringList &ids);	//!< UUIDs, collected until event loop is reached
+    void itemsChanged (const QStringList &ids);
+    void itemsRemoved (const QStringList &ids);
+private slots:
+    void emitItemNotifications();
+private:
+    enum ItemChange {ItemAdded, ItemChanged, ItemRemoved};
+    void notifyItem (TreeItem *ti, const ItemChange &change);
+    QTimer *itemNotifyTimer;
+    QSet <TreeItem*> itemsAddedPending;
+    QSet <TreeItem*> itemsChangedPending;
+    QStringList itemsRemovedPending;
+
 ////////////////////////////////////////////
 // Animation  **experimental**
 ////////////////////////////////////////////
 private:    
-    QTimer *animationTimer;
+    QTimer *animationTimer;	// fires once per frame
     bool animationUse;
     uint animationTicks;
-    uint animationInterval;
+    uint animationInterval;	// length of a tick in ms
+    uint animationFrameRate;	// frames per second
+    QElapsedTimer animationClock;
+    qint64 animationTicksDone;	// ticks since animationClock started
     int timerId;		// animation timer
-    QList <MapObj*> animObjList;// list with animated objects 
+    QSet <MapObj*> animObjects;	// set with animated objects 
 
 private slots:
-    void animate();			//!< Called by timer to animate stuff
+    void animate();			//!< Called by timer once per frame to animate stuff
 public:
     void startAnimation(BranchObj *bo, const QPointF &v);
     void startAnimation(BranchObj *bo, const QPointF &start, const QPointF &dest);
@@ -691,28 +926,57 @@ public:
 	Server		    //!< I am the server
     };
 
+    /*! \brief Frames of the change feed
+	
+	Each frame is sent as size (quint32), type (quint8), 
+	sequence number (quint32) and a list of strings.
+	A client sends Hello with the last sequence number it knows,
+	the server answers with the missing deltas or with a snapshot.
+    */
+    enum NetFrame {
+	NetHello,	    //!< Client: Last sequence number known, 0 for new client
+	NetSnapshot,	    //!< Server: Whole map as XML
+	NetDelta,	    //!< Server: Commands changing the map
+	NetAck		    //!< Client: Last sequence number applied
+    };
+
 private:
     // Network connections **Experimental**
     NetState netstate;		// offline, client, server
     QTcpServer *tcpServer;	// Act as server in conference mode (experimental)
-    QList <QTcpSocket*> clientList;	// List of connected clients
-    quint16 sendCounter;	// Increased with every sent command
+    QList <QTcpSocket*> clientList;	// List of clients in sync with server
+    QHash <QTcpSocket*, quint32> clientAcked;	// Last sequence number applied by client
+    quint32 sendCounter;	// Sequence number of last delta
+    QStringList sendQueue;	// Commands collected until event loop is reached
+    QTimer *sendTimer;
+    QList <QByteArray> sendHistory;	// Recent deltas for reconnecting clients
 
     QTcpSocket	*clientSocket;	// socket of this client
+    quint32 receiveCounter;	// Sequence number of last applied delta
     QString server;		// server address of this client
     int port;			// server port of this client
+    bool connectWaiting;	// connectToServer waits for result
+
+    QByteArray netFrame (const NetFrame &type, quint32 seq, const QStringList &data);
+    bool readNetFrame (QTcpSocket *socket, NetFrame &type, quint32 &seq, QStringList &data);
+    void sendSnapshot (QTcpSocket *socket=NULL);    //!< NULL: send to all clients
+    void applySnapshot (const QString &xml);
 
 protected:
     void sendSelection();
 
 public:
-    void newServer();
-    void connectToServer();
+    bool newServer(int p=54321);	//!< Returns false, if server couldn't be started
+    bool connectToServer(const QString &host="localhost", int p=54321, bool wait=false);	//!< With wait false, if not connected
 
 private slots:	
     void newClient();
+    void clientDisconnected();
     void sendData(const QString &s);
-    void readData();
+    void sendQueued();		//!< Send collected commands as one delta
+    void readClientData();	//!< Server: Hello and Ack from clients
+    void sendHello();
+    void readData();		//!< Client: Snapshot and deltas from server
     void displayNetworkError (QAbstractSocket::SocketError);
 
 public:
@@ -50,6 +50,10 @@ void VymText::copy (const VymText &other)
     filenamehint = other.filenamehint;
     textmode = other.textmode;
     color = other.color;
+    asciiValid = other.asciiValid;
+    asciiText = other.asciiText;
+    asciiIndent = other.asciiIndent;
+    asciiWidth = other.asciiWidth;
 }
 
 void VymText::clear()
@@ -59,6 +63,15 @@ void VymText::clear()
     filenamehint = "";
     textmode = AutoText;
     color = Qt::black;
+    invalidateCache();
+}
+
+void VymText::invalidateCache()
+{
+    asciiValid = false;
+    asciiText.clear();
+    asciiIndent.clear();
+    asciiWidth = 0;
 }
 
 void VymText::setRichText(bool b)
@@ -67,6 +80,7 @@ void VymText::setRichText(bool b)
         textmode = RichText;
     else
         textmode = PlainText;
+    invalidateCache();
 }
 
 bool VymText::isRichText()const
@@ -80,18 +94,21 @@ bool VymText::isRichText()const
 void VymText::setText (const QString &s)
 {
     text = s;
+    invalidateCache();
 }
 
 void VymText::setRichText (const QString &s)
 {
     text = s;
     textmode = RichText;
+    invalidateCache();
 }
 
 void VymText::setPlainText (const QString &s)
 {
     text = s;
     textmode = PlainText;
+    invalidateCache();
 }
 
 void VymText::setAutoText (const QString &s)
@@ -113,10 +130,15 @@ QString VymText::getTextASCII() const
     return getTextASCII ("",80);
 }
 
-QString VymText::getTextASCII(QString indent, const int &) const //FIXME-3 use width
+QString VymText::getTextASCII(QString indent, const int &w) const //FIXME-3 use width
 {
     if (text.isEmpty()) return text;
 
+    // Notes and headings are converted again and again during search 
+    // and exports, so keep the last result
+    if (asciiValid && asciiWidth == w && asciiIndent == indent) 
+        return asciiText;
+
     int width = 80;
     QString s;
     QRegExp rx;
@@ -127,57 +149,18 @@ QString VymText::getTextASCII(QString indent, const int &) const //FIXME-3 use w
     else
     {
         if ( fonthint == "fixed")
-        {
             s = text; 
-        } else
-        {
-            // Wordwrap
-
-            QString newnote;
-            QString curline;
-            uint n=0;
-            while ( (int)n < text.length() )
-            {
-                curline = curline + text.at(n);
-                if ( text.at(n) == '\n' )
-                {
-                    s = s + curline ;
-                    curline = "";
-                }
-
-                if (curline.length() > width)
-                {
-                    // Try to find last previous whitespace in curline
-                    uint i = curline.length() - 1;
-                    while ( i> 0 )
-                    {
-                        if ( curline.at(i) == ' ' )
-                        {
-                            s = s + curline.left(i) + '\n';
-                            curline = curline.right( curline.length() - i - 1 );
-                            break;
-                        }
-                        i--;
-                        if ( i == 0 )
-                        {
-                            // Cannot break this line into smaller parts
-                            s = s + curline;
-                            curline = "";
-                        }
-                    }
-                }
-                n++;
-            }
-            s = s + curline;
-        }
+        else
+            s = wrapText (width);
 
         // Indent lines
-        rx.setPattern("^");
-        s = s.replace (rx,indent);
-        rx.setPattern("\n");
-        s = s.replace (rx, "\n" + indent) + "\n";
+        s = indent + s.replace ('\n', "\n" + indent) + "\n";
 
-        return s.trimmed();
+        asciiText = s.trimmed();
+        asciiIndent = indent;
+        asciiWidth = w;
+        asciiValid = true;
+        return asciiText;
     }
 
     // Remove all <style...> ...</style>
@@ -220,6 +203,50 @@ QString VymText::getTextASCII(QString indent, const int &) const //FIXME-3 use w
     {
     }
 */
+    asciiText = s;
+    asciiIndent = indent;
+    asciiWidth = w;
+    asciiValid = true;
+    return s;
+}
+
+QString VymText::wrapText (const int &width) const
+{
+    // Break lines longer than width at the last space. 
+    // Lines without space are kept as they are.
+    QString s;
+    s.reserve (text.length() + text.length() / width + 1);
+    int start = 0;	    // Begin of current line in text
+    int space = -1;	    // Last space in current line, not at its begin
+    for (int n = 0; n < text.length(); n++)
+    {
+        QChar c = text.at(n);
+        if (c == '\n')
+        {
+            s.append (text.midRef (start, n - start + 1));
+            start = n + 1;
+            space = -1;
+            continue;
+        }
+        if (c == ' ' && n > start) space = n;
+
+        if (n - start + 1 > width)
+        {
+            if (space > start)
+            {
+                s.append (text.midRef (start, space - start));
+                s.append ('\n');
+                start = space + 1;
+            } else
+            {
+                // Cannot break this line into smaller parts
+                s.append (text.midRef (start, n - start + 1));
+                start = n + 1;
+            }
+            space = -1;
+        }
+    }
+    s.append (text.midRef (start));
     return s;
 }
 
@@ -227,6 +254,7 @@ void VymText::setFontHint (const QString &s)
 {
     // only for backward compatibility (pre 1.5 )
     fonthint=s;
+    invalidateCache();
 }
 
 QString VymText::getFontHint() const
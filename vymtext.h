@@ -42,10 +42,19 @@ public:
     QString saveToDir();
 
 protected:
+    void invalidateCache();
+    QString wrapText (const int &width) const;
+
     QString text;
     QString fonthint;
     QString filenamehint;
     TextMode textmode;
     QColor color;       // used for plaintext
+
+    // Cached result of getTextASCII
+    mutable bool asciiValid;
+    mutable QString asciiText;
+    mutable QString asciiIndent;
+    mutable int asciiWidth;
 };
 #endif
@@ -1,6 +1,7 @@
 #include "vymview.h"
 
 #include "branchitem.h"
+#include "branchiterator.h"
 #include "dockeditor.h"
 #include "mainwindow.h"
 #include "mapeditor.h"
@@ -205,32 +206,29 @@ void VymView::expandOneLevel()
 {
     int level=999999;
     int d;
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
+    BranchItem *cur;
     QModelIndex pix;
 
     // Find level to expand
-    model->nextBranch(cur,prev);
-    while (cur) 
+    BranchIterator it (model->getRootItem() );
+    while (it.hasNext() ) 
     {
+	cur=it.next();
 	pix=model->index (cur);
 	d=cur->depth();
 	if (!treeEditor->isExpanded(pix) && d < level)
 	    level=d;
-	model->nextBranch(cur,prev);	
     }
 
     // Expand all to level
-    cur=NULL;
-    prev=NULL;
-    model->nextBranch(cur,prev);
-    while (cur) 
+    it=BranchIterator (model->getRootItem() );
+    while (it.hasNext() ) 
     {
+	cur=it.next();
 	pix=model->index (cur);
 	d=cur->depth();
 	if (!treeEditor->isExpanded(pix) && d <= level && cur->branchCount()>0)
 	    treeEditor->setExpanded(pix,true);
-	model->nextBranch(cur,prev);	
     }
 }
 
@@ -238,39 +236,35 @@ void VymView::collapseOneLevel()
 {
     int level=-1;
     int d;
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
+    BranchItem *cur;
     QModelIndex pix;
 
     // Find level to collapse
-    model->nextBranch(cur,prev);
-    while (cur) 
+    BranchIterator it (model->getRootItem() );
+    while (it.hasNext() ) 
     {
+	cur=it.next();
 	pix=model->index (cur);
 	d=cur->depth();
 	if (treeEditor->isExpanded(pix) && d > level)
 	    level=d;
-	model->nextBranch(cur,prev);	
     }
 
     // collapse all to level
-    cur=NULL;
-    prev=NULL;
-    model->nextBranch(cur,prev);
-    while (cur) 
+    it=BranchIterator (model->getRootItem() );
+    while (it.hasNext() ) 
     {
+	cur=it.next();
 	pix=model->index (cur);
 	d=cur->depth();
 	if (treeEditor->isExpanded(pix) && d >= level)
 	    treeEditor->setExpanded(pix,false);
-	model->nextBranch(cur,prev);	
     }
 }
 
 void VymView::collapseUnselected()
 {
-    BranchItem *cur=NULL;
-    BranchItem *prev=NULL;
+    BranchItem *cur;
     QModelIndex pix;
 
     // Find level to collapse
@@ -280,17 +274,17 @@ void VymView::collapseUnselected()
     int level=selti->depth();
 
     // collapse all to level
-    model->nextBranch(cur,prev);
+    BranchIterator it (model->getRootItem() );
     //bool b=false;
-    while (cur) 
+    while (it.hasNext() ) 
     {
+	cur=it.next();
 	pix=model->index (cur);
 	if (treeEditor->isExpanded(pix) &&  level <= cur->depth())
 	{
 	    treeEditor->setExpanded(pix,false);
 	    //b=true;
 	}
-	model->nextBranch(cur,prev);	
     }
 
 /* FIXME-3 "collapse more" unimplemented yet
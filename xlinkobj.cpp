@@ -6,6 +6,9 @@
 #include "branchitem.h"
 #include "math.h"	// atan
 #include "misc.h"	// max
+#include "spatialindex.h"
+#include "vymmodel.h"
+#include "xlinkitem.h"
 
 /////////////////////////////////////////////////////////////////
 // XLinkObj
@@ -301,6 +304,16 @@ void XLinkObj::updateXLink()
     else	
 	path->setZValue (dZ_XLINK);
 
+    // Update area for hit testing, including the control points
+    XLinkItem *xli=link->getBeginLinkItem();
+    VymModel *model=link->getModel();
+    if (xli && model && model->getSpatialIndex() )
+    {
+	qreal d=clickBorder + 15;
+	QRectF r=clickPath.controlPointRect() | poly->boundingRect();
+	model->getSpatialIndex()->update (xli, r.adjusted (-d, -d, d, d) );
+    }
+
     setVisibility();
 }
 
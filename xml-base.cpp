@@ -1,8 +1,12 @@
 #include "xml-base.h"
 
 #include "vymmodel.h"
+#include "zipfile.h"
 
-parseBaseHandler::parseBaseHandler() {}
+parseBaseHandler::parseBaseHandler() 
+{
+    zipReader = NULL;
+}
 
 parseBaseHandler::~parseBaseHandler() {}
 
@@ -19,6 +23,26 @@ QString parseBaseHandler::parseHREF(QString href)
 	return tmpDir + path;
 }
 
+bool parseBaseHandler::readHREF(const QString &href, QByteArray &data)
+{
+    if (zipReader)
+    {
+        // Read member directly from archive
+        data = zipReader->fileData (href.section(":",1,1) );
+        if (data.isNull() )
+        {
+            qWarning()<<"parseBaseHandler::readHREF "<<zipReader->errorString();
+            return false;
+        }
+        return true;
+    }
+
+    QFile file (parseHREF (href) );
+    if (!file.open (QIODevice::ReadOnly) ) return false;
+    data = file.readAll();
+    return true;
+}
+
 bool parseBaseHandler::fatalError( const QXmlParseException& exception ) 
 {
     errorProt += QString( "Fatal parsing error: %1 in line %2, column %3\n")
@@ -34,7 +58,9 @@ bool parseBaseHandler::fatalError( const QXmlParseException& exception )
             qWarning()<<"parseBaseHandler::fatalError Couldn't read from "<<inputFile;
             return QXmlDefaultHandler::fatalError( exception );
         }
-    }
+    } else if (!inputData.isEmpty() )
+        // Input was read from archive
+        inputString = QString::fromUtf8 (inputData);
     QString s;
     QStringList sl = inputString.split ("\n");
     int i = 1;
@@ -60,6 +86,11 @@ void parseBaseHandler::setTmpDir (QString tp)
     tmpDir=tp;
 }
 
+void parseBaseHandler::setZipReader (ZipReader *z)
+{
+    zipReader = z;
+}
+
 void parseBaseHandler::setInputFile (const QString &s)
 {
     inputFile = s;
@@ -70,6 +101,11 @@ void parseBaseHandler::setInputString ( const QString &s)
     inputString = s;
 }
 
+void parseBaseHandler::setInputData ( const QByteArray &d)
+{
+    inputData = d;
+}
+
 void parseBaseHandler::setLoadMode (const LoadMode &lm, int p)
 {
     loadMode=lm;
@@ -8,6 +8,7 @@
 #include "file.h"
 
 class VymModel;
+class ZipReader;
 
 /*! \brief Base class for parsing maps from XML documents */
 
@@ -18,6 +19,7 @@ public:
     ~parseBaseHandler();
     QString errorProtocol();
     QString parseHREF(QString);
+    bool readHREF (const QString &href, QByteArray &data);
     virtual bool startElement ( const QString&, const QString&,
                         const QString& eName, const QXmlAttributes& atts )=0; 
     virtual bool   endElement ( const QString&, const QString&, const QString& )=0; 
@@ -27,8 +29,10 @@ public:
     bool fatalError( const QXmlParseException&);
     void setModel (VymModel *);
     void setTmpDir (QString);
+    void setZipReader (ZipReader *);
     void setInputFile ( const QString &);
     void setInputString ( const QString &);
+    void setInputData ( const QByteArray &);	//!< Decoded only for error messages
     void setLoadMode (const LoadMode &,int p=-1);
     bool readHtmlAttr    (const QXmlAttributes&);
 
@@ -42,8 +46,10 @@ protected:
     int branchDepth; 
     VymModel *model;
     QString tmpDir; 
+    ZipReader *zipReader;   // Read members from archive instead of tmpDir
     QString inputFile;
     QString inputString;
+    QByteArray inputData;
     QString htmldata;
     QString version;
 }; 
@@ -2,6 +2,7 @@
 
 #include <QMessageBox>
 #include <QColor>
+#include <QImage>
 #include <QTextStream>
 #include <typeinfo>
 
@@ -688,21 +689,18 @@ bool parseVYMHandler::readNoteAttr (const QXmlAttributes& a)
     {
         // Load note
         fn=parseHREF(a.value ("href") );
-        QFile file (fn);
-        QString s;                        // Reading a note
-
-        if ( !file.open( QIODevice::ReadOnly) )
+        QByteArray data;
+        if ( !readHREF (a.value ("href"), data) )
         {
             qWarning ()<<"parseVYMHandler::readNoteAttr:  Couldn't load "+fn;
             return false;
         }   
-        QTextStream stream( &file );
+        QTextStream stream( &data, QIODevice::ReadOnly );
         stream.setCodec("UTF-8");
         QString lines;
         while ( !stream.atEnd() ) {
             lines += stream.readLine()+"\n"; 
         }
-        file.close();
 
     lines ="<html><head><meta name=\"qrichtext\" content=\"1\" /></head><body>" + lines + "</p></body></html>";
     vymtext.setText (lines);   // this probably should set type, too...
@@ -722,7 +720,13 @@ bool parseVYMHandler::readImageAttr (const QXmlAttributes& a)
     if (!a.value( "href").isEmpty() )
     {
         // Load Image
-        if (!lastImage->load (parseHREF(a.value ("href") ) ))
+        QByteArray data;
+        QImage img;
+        if (readHREF (a.value ("href"), data) && img.loadFromData (data) )
+        {
+            lastImage->load (img);
+            lastImage->setOriginalFilename (parseHREF(a.value ("href") ) );
+        } else
         {
             QMessageBox::warning( 0, "Warning: " ,
                 "Couldn't load image\n"+parseHREF(a.value ("href") ));
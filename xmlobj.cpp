@@ -1,24 +1,59 @@
 #include "xmlobj.h"
 
+#include <QIODevice>
 #include <QRegExp>
 #include <QStringList>
+#include <QTextStream>
 
 
 // returns masked "<" ">" "&"
 QString quotemeta(const QString &s)
 {
-    QString r = s;
-    QRegExp  rx("&(?!amp;)");
-    r.replace ( rx,"&amp;");
-    rx.setPattern( ">");
-    r.replace ( rx,"&gt;");
-    rx.setPattern( "<");
-    r.replace ( rx,"&lt;");
-    rx.setPattern( "\"");
-    r.replace ( rx,"&quot;");
+    QString r;
+    appendQuotemeta (r, s);
     return r;
 }
 
+// Appends masked "<" ">" "&" '"' to dst in a single pass.
+// As before, an already masked "&amp;" is left untouched.
+void appendQuotemeta(QString &dst, const QString &s)
+{
+    const QChar *c = s.constData();
+    const QChar *end = c + s.length();
+    const QChar *run = c;   // start of unmasked characters not yet copied
+    for ( ; c < end; ++c)
+    {
+        const char *rep;
+        switch (c->unicode())
+        {
+            case '&':
+                if (end - c >= 5 && 
+                    c[1] == QLatin1Char('a') && 
+                    c[2] == QLatin1Char('m') &&
+                    c[3] == QLatin1Char('p') && 
+                    c[4] == QLatin1Char(';'))
+                    continue;
+                rep = "&amp;";
+                break;
+            case '>':
+                rep = "&gt;";
+                break;
+            case '<':
+                rep = "&lt;";
+                break;
+            case '"':
+                rep = "&quot;";
+                break;
+            default:
+                continue;
+        }
+        if (c > run) dst.append (run, c - run);
+        dst.append (QLatin1String (rep));
+        run = c + 1;
+    }
+    if (end > run) dst.append (run, end - run);
+}
+
 QString unquotemeta(const QString &s)
 {
     QString r = s;
@@ -126,7 +161,9 @@ QString XMLObj::endElement(QString s)
 // returns  at="val"
 QString XMLObj::attribut(QString at, QString val)
 {
-    return " " + at + "=\"" + quotemeta(val) + "\"";  
+    QString s;
+    appendAttribut (s, at, val);
+    return s;
 }
 
 // returns <s> val </s>
@@ -154,12 +191,98 @@ void XMLObj::decIndent()
 
 QString XMLObj::indent()
 {
-    QString s = "\n";
-    int i;
-    for (i=0; i < curIndent * indentWidth; i++)
-    {
-        s= s + " ";
-    }
+    QString s;
+    appendIndent (s);
     return s;
 }   
 
+// Precomputed newline followed by whitespace, used as indent table
+static const int indentTableSize = 256;
+static const QString indentTable = "\n" + QString (indentTableSize, ' ');
+
+void XMLObj::appendIndent(QString &dst)
+{
+    int n = curIndent * indentWidth;
+    if (n < indentTableSize)
+        dst.append (indentTable.constData(), n + 1);
+    else
+    {
+        dst.append (indentTable);
+        dst.append (QString (n - indentTableSize, ' '));
+    }
+}
+
+// appends  at="val"
+void XMLObj::appendAttribut(QString &dst, const QString &at, const QString &val)
+{
+    dst.append (' ');
+    dst.append (at);
+    dst.append (QLatin1String ("=\""));
+    appendQuotemeta (dst, val);
+    dst.append ('"');
+}
+
+// appends <s at>
+void XMLObj::appendBeginElement(QString &dst, const QString &s, const QString &at)
+{
+    appendIndent (dst);
+    dst.append ('<');
+    dst.append (s);
+    if (!at.isEmpty())
+    {
+        dst.append (' ');
+        dst.append (at);
+    }
+    dst.append ('>');
+}
+
+// appends <s at />
+void XMLObj::appendSingleElement(QString &dst, const QString &s, const QString &at)
+{
+    appendIndent (dst);
+    dst.append ('<');
+    dst.append (s);
+    dst.append (' ');
+    dst.append (at);
+    dst.append (QLatin1String (" />"));
+}
+
+// appends </s>
+void XMLObj::appendEndElement(QString &dst, const QString &s)
+{
+    appendIndent (dst);
+    dst.append (QLatin1String ("</"));
+    dst.append (s);
+    dst.append ('>');
+}
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+XMLWriter::XMLWriter(QIODevice *d)
+{
+    stream = new QTextStream (d);
+    stream->setCodec("UTF-8");
+}
+
+XMLWriter::~XMLWriter()
+{
+    stream->flush();
+    delete stream;
+}
+
+XMLWriter& XMLWriter::operator<< (const QString &s)
+{
+    *stream << s;
+    return *this;
+}
+
+void XMLWriter::flush()
+{
+    stream->flush();
+}
+
+bool XMLWriter::isOk()
+{
+    return stream->status() == QTextStream::Ok;
+}
@@ -1,9 +1,12 @@
 #ifndef XMLOBJ_H
 #define XMLOBJ_H
 
+class QIODevice;
 class QString;
+class QTextStream;
 
 QString quotemeta( const QString& );  
+void appendQuotemeta( QString &dst, const QString &s );
 QString unquotemeta( const QString& );	
 QString quoteQuotes( const QString & );
 QString unquoteQuotes( const QString & );
@@ -23,6 +26,14 @@ public:
     QString attribut    (QString,QString);	    // name, val
     QString valueElement(QString,QString);	    // name, val
     QString valueElement(QString,QString,QString);  // name, val, attr
+
+    // Writer API: append directly into a caller supplied buffer
+    void appendIndent      (QString &dst);
+    void appendAttribut    (QString &dst, const QString &at, const QString &val);
+    void appendBeginElement(QString &dst, const QString &s, const QString &at);
+    void appendSingleElement(QString &dst, const QString &s, const QString &at);
+    void appendEndElement  (QString &dst, const QString &s);
+
     void incIndent();
     void decIndent();
     static int curIndent;
@@ -32,4 +43,23 @@ protected:
     int indentWidth;
 };
 
+/////////////////////////////////////////////////////////////////////////////
+/*! \brief Streaming output for XML data
+
+    Used by saveToDir to write the map directly to a QIODevice in UTF-8,
+    so that the complete document never needs to be kept in memory.
+*/
+class XMLWriter
+{
+public:
+    XMLWriter(QIODevice *d);
+    virtual ~XMLWriter();
+    XMLWriter& operator<< (const QString &s);
+    void flush();
+    bool isOk();
+
+protected:
+    QTextStream *stream;
+};
+
 #endif
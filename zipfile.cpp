@@ -0,0 +1,490 @@
+#include <QDebug>
+#include <QFileInfo>
+
+#include <zlib.h>
+
+#include "zipfile.h"
+
+// Signatures of zip records
+static const quint32 localHeaderSig   = 0x04034b50;
+static const quint32 centralHeaderSig = 0x02014b50;
+static const quint32 endOfCentralSig  = 0x06054b50;
+
+static const int localHeaderSize   = 30;
+static const int centralHeaderSize = 46;
+static const int endOfCentralSize  = 22;
+
+static const quint16 methodStored   = 0;
+static const quint16 methodDeflated = 8;
+static const quint16 flagUtf8Names  = 0x0800;
+
+// zip records are little endian
+static quint16 readUShort (const char *p)
+{
+    const uchar *u = (const uchar*)p;
+    return u[0] | (u[1] << 8);
+}
+
+static quint32 readUInt (const char *p)
+{
+    const uchar *u = (const uchar*)p;
+    return u[0] | (u[1] << 8) | (u[2] << 16) | ((quint32)u[3] << 24);
+}
+
+static void appendUShort (QByteArray &b, quint16 v)
+{
+    b.append ((char)(v & 0xff));
+    b.append ((char)((v >> 8) & 0xff));
+}
+
+static void appendUInt (QByteArray &b, quint32 v)
+{
+    appendUShort (b, v & 0xffff);
+    appendUShort (b, (v >> 16) & 0xffff);
+}
+
+static quint32 crcOf (const QByteArray &data)
+{
+    quint32 crc = crc32 (0L, Z_NULL, 0);
+    return crc32 (crc, (const Bytef*)data.constData(), data.size() );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+ZipReader::ZipReader (const QString &fileName)
+{
+    file.setFileName (fileName);
+}
+
+ZipReader::~ZipReader()
+{
+    close();
+}
+
+bool ZipReader::open()
+{
+    entries.clear();
+    error.clear();
+
+    if (!file.open (QIODevice::ReadOnly))
+    {
+	error = QString ("Could not open %1: %2").arg(file.fileName()).arg(file.errorString());
+	return false;
+    }
+
+    // Find "end of central directory" record, which may be
+    // followed by an archive comment of up to 64k
+    qint64 size = file.size();
+    if (size < endOfCentralSize)
+    {
+	error = QString ("%1 is not a zip archive").arg(file.fileName());
+	file.close();
+	return false;
+    }
+    qint64 tailSize = qMin (size, (qint64) 0xffff + endOfCentralSize);
+    file.seek (size - tailSize);
+    QByteArray tail = file.read (tailSize);
+
+    int eocd = -1;
+    for (int i = tail.size() - endOfCentralSize; i >= 0; --i)
+	if (readUInt (tail.constData() + i) == endOfCentralSig)
+	{
+	    eocd = i;
+	    break;
+	}
+    if (eocd < 0)
+    {
+	error = QString ("%1 is not a zip archive").arg(file.fileName());
+	file.close();
+	return false;
+    }
+
+    const char *p = tail.constData() + eocd;
+    quint16 count    = readUShort (p + 10);
+    quint32 cdSize   = readUInt (p + 12);
+    quint32 cdOffset = readUInt (p + 16);
+
+    if (cdOffset == 0xffffffff || (qint64)cdOffset + cdSize > size)
+    {
+	error = QString ("%1: Unsupported or broken zip archive").arg(file.fileName());
+	file.close();
+	return false;
+    }
+
+    file.seek (cdOffset);
+    QByteArray cd = file.read (cdSize);
+    int pos = 0;
+    for (int i = 0; i < count; ++i)
+    {
+	if (pos + centralHeaderSize > cd.size() || readUInt (cd.constData() + pos) != centralHeaderSig)
+	{
+	    error = QString ("%1: Broken central directory").arg(file.fileName());
+	    entries.clear();
+	    file.close();
+	    return false;
+	}
+	const char *h = cd.constData() + pos;
+	quint16 nameLen    = readUShort (h + 28);
+	quint16 extraLen   = readUShort (h + 30);
+	quint16 commentLen = readUShort (h + 32);
+
+	Entry e;
+	e.method         = readUShort (h + 10);
+	e.crc            = readUInt (h + 16);
+	e.compressedSize = readUInt (h + 20);
+	e.size           = readUInt (h + 24);
+	e.offset         = readUInt (h + 42);
+	e.name = QString::fromUtf8 (h + centralHeaderSize,
+	    qMin ((int)nameLen, cd.size() - pos - centralHeaderSize) );
+	entries.append (e);
+
+	pos += centralHeaderSize + nameLen + extraLen + commentLen;
+    }
+    return true;
+}
+
+bool ZipReader::isOpen()
+{
+    return file.isOpen();
+}
+
+void ZipReader::close()
+{
+    if (file.isOpen()) file.close();
+}
+
+QString ZipReader::errorString()
+{
+    return error;
+}
+
+QStringList ZipReader::entryNames()
+{
+    QStringList list;
+    foreach (Entry e, entries)
+	if (!e.name.endsWith ("/")) list.append (e.name);
+    return list;
+}
+
+bool ZipReader::contains (const QString &name)
+{
+    return findEntry (name) >= 0;
+}
+
+int ZipReader::findEntry (const QString &name)
+{
+    for (int i = 0; i < entries.size(); ++i)
+	if (entries.at(i).name == name) return i;
+    return -1;
+}
+
+QByteArray ZipReader::fileData (const QString &name)
+{
+    int i = findEntry (name);
+    if (i < 0)
+    {
+	error = QString ("%1 not found in archive").arg(name);
+	return QByteArray();
+    }
+    return readEntry (entries.at(i));
+}
+
+QByteArray ZipReader::readEntry (const Entry &e)
+{
+    if (!file.isOpen() || !file.seek (e.offset))
+    {
+	error = QString ("Could not read %1").arg(e.name);
+	return QByteArray();
+    }
+
+    // Local header may have an extra field different from central header
+    QByteArray header = file.read (localHeaderSize);
+    if (header.size() < localHeaderSize || readUInt (header.constData()) != localHeaderSig)
+    {
+	error = QString ("Broken local header for %1").arg(e.name);
+	return QByteArray();
+    }
+    file.seek (e.offset + localHeaderSize
+	+ readUShort (header.constData() + 26)
+	+ readUShort (header.constData() + 28));
+    QByteArray raw = file.read (e.compressedSize);
+    if ((quint32)raw.size() != e.compressedSize)
+    {
+	error = QString ("Unexpected end of archive in %1").arg(e.name);
+	return QByteArray();
+    }
+
+    QByteArray data;
+    if (e.method == methodStored)
+	data = raw;
+    else if (e.method == methodDeflated)
+    {
+	data.resize (e.size);
+	z_stream zs;
+	zs.zalloc   = Z_NULL;
+	zs.zfree    = Z_NULL;
+	zs.opaque   = Z_NULL;
+	zs.next_in  = (Bytef*)raw.data();
+	zs.avail_in = raw.size();
+	zs.next_out = (Bytef*)data.data();
+	zs.avail_out= data.size();
+	// Negative window bits: raw deflate stream without zlib header
+	if (inflateInit2 (&zs, -MAX_WBITS) != Z_OK)
+	{
+	    error = QString ("Could not initialize decompression");
+	    return QByteArray();
+	}
+	int r = inflate (&zs, Z_FINISH);
+	inflateEnd (&zs);
+	if (r != Z_STREAM_END)
+	{
+	    error = QString ("Could not decompress %1").arg(e.name);
+	    return QByteArray();
+	}
+    } else
+    {
+	error = QString ("Unsupported compression method %1 for %2").arg(e.method).arg(e.name);
+	return QByteArray();
+    }
+
+    if (crcOf (data) != e.crc)
+    {
+	error = QString ("CRC error in %1").arg(e.name);
+	return QByteArray();
+    }
+    return data;
+}
+
+bool ZipReader::extractAll (const QDir &dir)
+{
+    foreach (Entry e, entries)
+    {
+	// Don't write outside of dir, but allow names like "a..b.png"
+	QString name = QDir::cleanPath (e.name);
+	if (QDir::isAbsolutePath (name) || name == ".." || name.startsWith ("../") )
+	{
+	    error = QString ("Refusing to extract %1").arg(e.name);
+	    return false;
+	}
+
+	QString path = dir.path() + "/" + e.name;
+	if (e.name.endsWith ("/"))
+	{
+	    if (!dir.mkpath (e.name))
+	    {
+		error = QString ("Could not create %1").arg(path);
+		return false;
+	    }
+	    continue;
+	}
+
+	int i = e.name.lastIndexOf ("/");
+	if (i > 0 && !dir.mkpath (e.name.left(i)) )
+	{
+	    error = QString ("Could not create %1").arg(path);
+	    return false;
+	}
+
+	QByteArray data = readEntry (e);
+	if (data.isNull() && e.size > 0) return false;
+
+	QFile out (path);
+	if (!out.open (QIODevice::WriteOnly) || out.write (data) != data.size() )
+	{
+	    error = QString ("Could not write %1: %2").arg(path).arg(out.errorString());
+	    return false;
+	}
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+ZipWriter::ZipWriter (const QString &fileName)
+{
+    file.setFileName (fileName);
+
+    QDateTime now = QDateTime::currentDateTime();
+    QTime t = now.time();
+    QDate d = now.date();
+    dosTime = (t.hour() << 11) | (t.minute() << 5) | (t.second() / 2);
+    dosDate = ((d.year() - 1980) << 9) | (d.month() << 5) | d.day();
+}
+
+ZipWriter::~ZipWriter()
+{
+    if (file.isOpen()) close();
+}
+
+bool ZipWriter::open()
+{
+    entries.clear();
+    error.clear();
+    if (!file.open (QIODevice::WriteOnly))
+    {
+	error = QString ("Could not open %1: %2").arg(file.fileName()).arg(file.errorString());
+	return false;
+    }
+    return true;
+}
+
+QString ZipWriter::errorString()
+{
+    return error;
+}
+
+bool ZipWriter::addFile (const QString &name, const QByteArray &data)
+{
+    return addEntry (name, data, false);
+}
+
+bool ZipWriter::addDirectory (const QString &name)
+{
+    QString n = name;
+    if (!n.endsWith ("/")) n += "/";
+    return addEntry (n, QByteArray(), true);
+}
+
+bool ZipWriter::addDir (const QDir &dir, const QString &prefix)
+{
+    QFileInfoList list = dir.entryInfoList (
+	QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot, QDir::Name);
+    foreach (QFileInfo fi, list)
+    {
+	QString name = prefix + fi.fileName();
+	if (fi.isDir())
+	{
+	    if (!addDirectory (name) || !addDir (QDir (fi.filePath()), name + "/"))
+		return false;
+	} else
+	{
+	    QFile in (fi.filePath());
+	    if (!in.open (QIODevice::ReadOnly))
+	    {
+		error = QString ("Could not read %1: %2").arg(fi.filePath()).arg(in.errorString());
+		return false;
+	    }
+	    if (!addFile (name, in.readAll()) ) return false;
+	}
+    }
+    return true;
+}
+
+bool ZipWriter::addEntry (const QString &name, const QByteArray &data, bool isDir)
+{
+    if (!file.isOpen())
+    {
+	error = "Archive not open";
+	return false;
+    }
+    if (entries.size() >= 0xffff || file.pos() + data.size() >= 0xffffffffLL)
+    {
+	error = "Archive too large";
+	return false;
+    }
+
+    Entry e;
+    e.name   = name.toUtf8();
+    e.size   = data.size();
+    e.crc    = crcOf (data);
+    e.offset = file.pos();
+    e.externalAttr = isDir ? ((040755 << 16) | 0x10) : (0100644 << 16);
+
+    // Deflate into memory, store if that doesn't pay off
+    QByteArray compressed;
+    e.method = methodStored;
+    if (!data.isEmpty())
+    {
+	z_stream zs;
+	zs.zalloc = Z_NULL;
+	zs.zfree  = Z_NULL;
+	zs.opaque = Z_NULL;
+	if (deflateInit2 (&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+	    error = "Could not initialize compression";
+	    return false;
+	}
+	compressed.resize (deflateBound (&zs, data.size()));
+	zs.next_in  = (Bytef*)data.constData();
+	zs.avail_in = data.size();
+	zs.next_out = (Bytef*)compressed.data();
+	zs.avail_out= compressed.size();
+	int r = deflate (&zs, Z_FINISH);
+	compressed.resize (zs.total_out);
+	deflateEnd (&zs);
+	if (r != Z_STREAM_END)
+	{
+	    error = QString ("Could not compress %1").arg(name);
+	    return false;
+	}
+	if (compressed.size() < data.size()) e.method = methodDeflated;
+    }
+    const QByteArray &payload = (e.method == methodDeflated) ? compressed : data;
+    e.compressedSize = payload.size();
+
+    QByteArray header;
+    header.reserve (localHeaderSize + e.name.size());
+    appendUInt   (header, localHeaderSig);
+    appendUShort (header, 20);		// version needed to extract
+    appendUShort (header, flagUtf8Names);
+    appendUShort (header, e.method);
+    appendUShort (header, dosTime);
+    appendUShort (header, dosDate);
+    appendUInt   (header, e.crc);
+    appendUInt   (header, e.compressedSize);
+    appendUInt   (header, e.size);
+    appendUShort (header, e.name.size());
+    appendUShort (header, 0);		// extra field length
+    header.append (e.name);
+
+    if (file.write (header) != header.size() || file.write (payload) != payload.size())
+    {
+	error = QString ("Could not write %1: %2").arg(file.fileName()).arg(file.errorString());
+	return false;
+    }
+    entries.append (e);
+    return true;
+}
+
+bool ZipWriter::close()
+{
+    if (!file.isOpen()) return error.isEmpty();
+
+    quint32 cdOffset = file.pos();
+    QByteArray cd;
+    foreach (Entry e, entries)
+    {
+	appendUInt   (cd, centralHeaderSig);
+	appendUShort (cd, (3 << 8) | 20);	// made by unix, version 2.0
+	appendUShort (cd, 20);			// version needed to extract
+	appendUShort (cd, flagUtf8Names);
+	appendUShort (cd, e.method);
+	appendUShort (cd, dosTime);
+	appendUShort (cd, dosDate);
+	appendUInt   (cd, e.crc);
+	appendUInt   (cd, e.compressedSize);
+	appendUInt   (cd, e.size);
+	appendUShort (cd, e.name.size());
+	appendUShort (cd, 0);			// extra field length
+	appendUShort (cd, 0);			// comment length
+	appendUShort (cd, 0);			// disk number
+	appendUShort (cd, 0);			// internal attributes
+	appendUInt   (cd, e.externalAttr);
+	appendUInt   (cd, e.offset);
+	cd.append (e.name);
+    }
+
+    quint32 cdSize = cd.size();
+    appendUInt   (cd, endOfCentralSig);
+    appendUShort (cd, 0);			// number of this disk
+    appendUShort (cd, 0);			// disk with central directory
+    appendUShort (cd, entries.size());
+    appendUShort (cd, entries.size());
+    appendUInt   (cd, cdSize);
+    appendUInt   (cd, cdOffset);
+    appendUShort (cd, 0);			// comment length
+
+    bool ok = file.write (cd) == cd.size();
+    if (!ok)
+	error = QString ("Could not write %1: %2").arg(file.fileName()).arg(file.errorString());
+    file.close();
+    return ok && error.isEmpty();
+}
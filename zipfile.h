@@ -0,0 +1,90 @@
+#ifndef ZIPFILE_H
+#define ZIPFILE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/////////////////////////////////////////////////////////////////////////////
+/*! \brief Read members of a zip archive in-process
+
+    Supports stored and deflated members (zlib), which covers all .vym
+    files written by vym itself or by the usual zip tools.
+*/
+class ZipReader
+{
+public:
+    ZipReader (const QString &fileName);
+    ~ZipReader();
+    bool open();			//! false, if file is not a zip archive
+    bool isOpen();
+    void close();
+    QString errorString();
+
+    QStringList entryNames();		//! Files only, no directories
+    bool contains (const QString &name);
+    QByteArray fileData (const QString &name);
+    bool extractAll (const QDir &dir);
+
+private:
+    struct Entry
+    {
+	QString name;
+	quint16 method;
+	quint32 crc;
+	quint32 compressedSize;
+	quint32 size;
+	quint32 offset;			// of local header
+    };
+    int findEntry (const QString &name);
+    QByteArray readEntry (const Entry &e);
+
+    QFile file;
+    QList <Entry> entries;
+    QString error;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+/*! \brief Write a zip archive in-process
+
+    Members are deflated in memory and written sequentially, followed by
+    the central directory on close().
+*/
+class ZipWriter
+{
+public:
+    ZipWriter (const QString &fileName);
+    ~ZipWriter();
+    bool open();
+    bool close();
+    QString errorString();
+
+    bool addFile (const QString &name, const QByteArray &data);
+    bool addDirectory (const QString &name);
+    bool addDir (const QDir &dir, const QString &prefix = QString() );	//! recursively
+
+private:
+    struct Entry
+    {
+	QByteArray name;
+	quint16 method;
+	quint32 crc;
+	quint32 compressedSize;
+	quint32 size;
+	quint32 offset;
+	quint32 externalAttr;
+    };
+    bool addEntry (const QString &name, const QByteArray &data, bool isDir);
+
+    QFile file;
+    QList <Entry> entries;
+    QString error;
+    quint16 dosTime;
+    quint16 dosDate;
+};
+
+#endif